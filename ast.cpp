@@ -98,6 +98,8 @@ std::wostream& operator<< (std::wostream& o, AST_Node* node) {
 
 void print(std::wostream& o, AST_Fn* fn, bool decl) {
     if (decl) {
+        if (fn->is_exported)
+            o << "export ";
         o << "fn ";
         if (fn->name)
             o << fn->name;
@@ -119,6 +121,10 @@ void print(std::wostream& o, AST_Fn* fn, bool decl) {
 
         if (fn->is_extern) {
             o << ";\n";
+        } else if (fn->body_token) {
+            // With --skim the body isn't parsed until the function is typechecked,
+            // printing the empty block would look like the function does nothing
+            o << " { ... skimmed }\n";
         } else {
             o << ' ' << &fn->block;
         }
@@ -33,9 +33,13 @@ struct AST_Value : AST_Node {
 
 struct AST_Type : AST_Value {
     u64 size;
-    inline AST_Type(AST_NodeType nodetype, u64 size) 
+
+    // The type's ID in the TypeTable, 0 until it has one
+    u32 type_id;
+
+    inline AST_Type(AST_NodeType nodetype, u64 size, u32 type_id = 0) 
         : AST_Value(nodetype, (AST_Type*)&t_type), 
-          size(size) {}
+          size(size), type_id(type_id) {}
 };
 
 struct AST_UnresolvedId : AST_Value {
@@ -69,28 +73,35 @@ struct AST_Call : AST_Value {
     TokenType            op;
     AST_Value           *fn;
     struct TIR_Builder  *builder;
-    arr<AST_Value*> args;
 
-    inline AST_Call(CallKind kind, TokenType op, AST_Value* fn, u32 args_reserve) 
-        : AST_Value(AST_FN_CALL, nullptr), kind(kind), op(op), fn(fn), args(args_reserve), builder(nullptr) {}
+    // The arguments live in a single block of the AST allocator, allocated when the call is
+    // parsed with room for all of them, so pointers to the argument slots stay valid
+    arr_ref<AST_Value*> args;
+
+    inline AST_Call(CallKind kind, TokenType op, AST_Value* fn, AST_Value **args_buffer) 
+        : AST_Value(AST_FN_CALL, nullptr), kind(kind), op(op), fn(fn), args { args_buffer, 0 }, builder(nullptr) {}
 };
 
 struct AST_PrimitiveType : AST_Type {
     PrimitiveTypeKind kind;
     const char* name;
 
-    inline AST_PrimitiveType(PrimitiveTypeKind kind, u64 size, const char* name)
-        : AST_Type(AST_PRIMITIVE_TYPE, size), kind(kind), name(name) {}
+    // The primitives are shared by every AST_GlobalContext, so their IDs are fixed (see primitive_types)
+    inline AST_PrimitiveType(u32 type_id, PrimitiveTypeKind kind, u64 size, const char* name)
+        : AST_Type(AST_PRIMITIVE_TYPE, size, type_id), kind(kind), name(name) {}
 };
 
 // VOLATILE - if you add stuff to this, you MUST update its map_hash and map_equals
 struct AST_FnType : AST_Type {
     AST_Type* returntype;
-    // TODO we can probably get away with a regular arr here
+
+    // Parameter types are stored inline up to 4 parameters.
+    // The rest goes into the AST allocator, which outlives the temporary function types
     bucketed_arr<AST_Type*> param_types;
     bool is_variadic;
 
-    inline AST_FnType(u64 size) : AST_Type(AST_FN_TYPE, size), is_variadic(false) {}
+    inline AST_FnType(u64 size, linear_alloc *allocator)
+        : AST_Type(AST_FN_TYPE, size), param_types(allocator), is_variadic(false) {}
 };
 
 
@@ -182,6 +193,16 @@ struct AST_Fn : AST_FnLike {
 
     bool is_extern = false;
 
+    // Exported functions keep external linkage and the C calling convention,
+    // everything else is internal to the module (see is_exported in tir.h
+    // and T2L_Context::strip_dead_symbols)
+    bool is_exported = false;
+
+    // If the parser has skimmed over the body, this is the index of its '{' token.
+    // The body is parsed by parse_fn_body when the function is typechecked
+    u32 body_file_id = 0;
+    u64 body_token = 0;
+
     inline AST_FnType *fntype() { return (AST_FnType*)type; };
 
     inline AST_Fn(AST_Context* parent_ctx, const char* name) 
@@ -214,9 +235,10 @@ struct AST_Struct : AST_Type {
     const char* name;
     bucketed_arr<StructElement> members;
     u64 alignment;
-    inline AST_Struct(const char* name) 
+    inline AST_Struct(const char* name, linear_alloc *allocator) 
         : AST_Type(AST_STRUCT, 0), 
           name(name),
+          members(allocator),
           alignment(0) {}
 };
 
@@ -252,8 +274,12 @@ struct AST_Dereference : AST_Value {
 struct AST_ZeroExtend : AST_Value {
     AST_Value *inner;
 
+    // The extension is reported at the location of the value it extends
     inline AST_ZeroExtend(AST_Value* ptr, AST_Type *type) 
-        : AST_Value(AST_ZEROEXTEND, type), inner(ptr) {}
+        : AST_Value(AST_ZEROEXTEND, type), inner(ptr) 
+    {
+        location_id = ptr->location_id;
+    }
 };
 
 struct AST_Typeof : AST_Value {
@@ -1,36 +1,44 @@
 #include "llvm.h"
 #include <iostream>
+#include <sstream>
 
 using namespace llvm;
 
 T2L_Context::T2L_Context(TIR_Context& tirc) 
     : tir_context(tirc), mod("ntrmod", lc), builder(lc) 
 {
-    translated_types.insert(&t_bool, IntegerType::get(lc, 1));
-    translated_types.insert(&t_u8,   IntegerType::get(lc, 8));
-    translated_types.insert(&t_u16,  IntegerType::get(lc, 16));
-    translated_types.insert(&t_u32,  IntegerType::get(lc, 32));
-    translated_types.insert(&t_u64,  IntegerType::get(lc, 64));
-    translated_types.insert(&t_i8,   IntegerType::get(lc, 8));
-    translated_types.insert(&t_i16,  IntegerType::get(lc, 16));
-    translated_types.insert(&t_i32,  IntegerType::get(lc, 32));
-    translated_types.insert(&t_i64,  IntegerType::get(lc, 64));
-    translated_types.insert(&t_f32,  Type::getFloatTy(lc));
-    translated_types.insert(&t_f64,  Type::getFloatTy(lc));
-    translated_types.insert(&t_void, Type::getVoidTy(lc));
-    translated_types.insert(&t_any8, IntegerType::get(lc, 64));
+    translated_type(&t_bool) = IntegerType::get(lc, 1);
+    translated_type(&t_u8)   = IntegerType::get(lc, 8);
+    translated_type(&t_u16)  = IntegerType::get(lc, 16);
+    translated_type(&t_u32)  = IntegerType::get(lc, 32);
+    translated_type(&t_u64)  = IntegerType::get(lc, 64);
+    translated_type(&t_i8)   = IntegerType::get(lc, 8);
+    translated_type(&t_i16)  = IntegerType::get(lc, 16);
+    translated_type(&t_i32)  = IntegerType::get(lc, 32);
+    translated_type(&t_i64)  = IntegerType::get(lc, 64);
+    translated_type(&t_f32)  = Type::getFloatTy(lc);
+    translated_type(&t_f64)  = Type::getFloatTy(lc);
+    translated_type(&t_void) = Type::getVoidTy(lc);
+    translated_type(&t_any8) = IntegerType::get(lc, 64);
+}
+
+llvm::Type *&T2L_Context::translated_type(AST_Type *type) {
+    u32 id = tir_context.global.type_table.id_of(type);
+    while (translated_types.size <= id)
+        translated_types.push(nullptr);
+    return translated_types[id];
 }
 
 llvm::Constant *get_constant(T2L_Context *ctx, TIR_Value tir_val) {
     switch (tir_val.valuespace) {
         case TVS_VALUE: {
-            llvm::Type *l_type = ctx->translated_types[tir_val.type];
+            llvm::Type *l_type = ctx->translated_type(tir_val.type);
             assert(l_type);
             return ConstantInt::get(l_type, tir_val.offset, false);
         }
         case TVS_C_STRING_LITERAL: {
             llvm::Constant* l_val = llvm::ConstantDataArray::getString(ctx->lc, (const char*)tir_val.offset, true); // POINTERSIZE
-            auto l_var = new llvm::GlobalVariable(ctx->mod, l_val->getType(), true, GlobalValue::WeakAnyLinkage, l_val, "");
+            auto l_var = new llvm::GlobalVariable(ctx->mod, l_val->getType(), true, GlobalValue::PrivateLinkage, l_val, "");
             return l_var;
         }
         default:
@@ -42,8 +50,7 @@ llvm::FunctionType *T2L_Context::get_function_type(TIR_Function* fn) {
     arr<llvm::Type*> l_param_types;
     AST_FnType *fntype = fn->ast_fn->fntype();
 
-    llvm::Type *llvm_fntype;
-    if (translated_types.find(fntype, &llvm_fntype)) {
+    if (llvm::Type *llvm_fntype = translated_type(fntype)) {
         return (llvm::FunctionType*)llvm_fntype;
     }
 
@@ -58,13 +65,12 @@ llvm::FunctionType *T2L_Context::get_function_type(TIR_Function* fn) {
             ArrayRef<llvm::Type*>(l_param_types.buffer, l_param_types.size),
             fntype->is_variadic);
 
-    translated_types.insert(fntype, l_fn_type);
+    translated_type(fntype) = l_fn_type;
     return l_fn_type;
 }
 
 llvm::Type *T2L_Context::get_llvm_type(AST_Type* type) {
-    llvm::Type* t;
-    if (translated_types.find(type, &t))
+    if (llvm::Type* t = translated_type(type))
         return t;
 
     switch (type->nodetype) {
@@ -78,7 +84,7 @@ llvm::Type *T2L_Context::get_llvm_type(AST_Type* type) {
             llvm::Type* l_pointed_type = get_llvm_type(pt->pointed_type);
             llvm::Type* l_pt = PointerType::get(l_pointed_type, 0);
 
-            translated_types.insert(type, l_pt);
+            translated_type(type) = l_pt;
             return l_pt;
         }
 
@@ -88,7 +94,7 @@ llvm::Type *T2L_Context::get_llvm_type(AST_Type* type) {
 
             llvm::ArrayType *llvm_array_type = llvm::ArrayType::get(l_base_type, at->array_length);
 
-            translated_types.insert(type, llvm_array_type);
+            translated_type(type) = llvm_array_type;
             return llvm_array_type;
         }
 
@@ -103,7 +109,7 @@ llvm::Type *T2L_Context::get_llvm_type(AST_Type* type) {
             llvm::ArrayRef<llvm::Type*> ref(elements.begin(), elements.end());
 
             llvm::StructType *llvm_struct = llvm::StructType::create(lc, ref);
-            translated_types.insert(type, llvm_struct);
+            translated_type(type) = llvm_struct;
             return llvm_struct;
         }
 
@@ -256,8 +262,7 @@ llvm::Value* T2L_BlockContext::get_value(TIR_Value tir_val) {
         }
 
         case TVS_GLOBAL: {
-            llvm::Value* ptr_val = ctx->translated_globals[tir_val];
-            return ptr_val;
+            return ctx->get_global(tir_val);
         }
 
 
@@ -418,9 +423,7 @@ void T2L_BlockContext::compile() {
                     break;
                 }
                 case TOPC_CALL: {
-                    AST_Fn* callee = instr.call.fn->ast_fn;
-
-                    llvm::Function* l_callee = (llvm::Function*)fn->t2l_context->global_functions[callee]->llvm_fn;
+                    llvm::Function* l_callee = fn->t2l_context->get_function(instr.call.fn)->llvm_fn;
                     assert(l_callee); // TODO
 
                     u32 argc = instr.call.args.size;
@@ -434,6 +437,7 @@ void T2L_BlockContext::compile() {
                     }
 
                     llvm::CallInst* l_result = builder.CreateCall(l_callee, ArrayRef<llvm::Value*>(args, argc));
+                    l_result->setCallingConv(l_callee->getCallingConv());
 
                     if (instr.call.dst) {
                         set_value(&instr, l_result);
@@ -502,9 +506,16 @@ void T2L_BlockContext::compile() {
 
 void T2L_FunctionContext::compile_header() {
     llvm::FunctionType* l_fn_type = t2l_context->get_function_type(tir_fn);
-
-    auto linkage = tir_fn->ast_fn->is_extern ? llvm::GlobalValue::ExternalLinkage : llvm::GlobalValue::WeakAnyLinkage;
-    llvm_fn = Function::Create(l_fn_type, linkage, tir_fn->ast_fn->name, t2l_context->mod);
+    AST_Fn *ast_fn = tir_fn->ast_fn;
+
+    // Functions that aren't visible outside the module can use whatever calling convention
+    // they want, and LLVM is free to inline them, specialize them or drop them
+    if (ast_fn->is_extern || is_exported(ast_fn)) {
+        llvm_fn = Function::Create(l_fn_type, llvm::GlobalValue::ExternalLinkage, ast_fn->name, t2l_context->mod);
+    } else {
+        llvm_fn = Function::Create(l_fn_type, llvm::GlobalValue::InternalLinkage, ast_fn->name, t2l_context->mod);
+        llvm_fn->setCallingConv(llvm::CallingConv::Fast);
+    }
 
     for (u32 i = 0; i < tir_fn->parameters.size; i++)
         if (tir_fn->parameters[i].flags & TVF_BYVAL) {
@@ -592,6 +603,12 @@ void T2L_FunctionContext::compile() {
         block->compile();
 }
 
+void T2L_FunctionContext::release() {
+    for (T2L_BlockContext* block : blocks)
+        delete block;
+    blocks = arr<T2L_BlockContext*>(0);
+}
+
 const char* T2L_Context::output_object() {
     LLVMInitializeNativeTarget();
     LLVMInitializeNativeAsmPrinter();
@@ -641,7 +658,7 @@ void insert_entry_boilerplate(T2L_Context& c, Function* l_main) {
     Type* l_void_type = Type::getVoidTy(c.lc);
 
     // TODO we're assuming libc int == i32
-    Type* l_exit_params[] = { c.translated_types[&t_i32] };
+    Type* l_exit_params[] = { c.translated_type(&t_i32) };
 
     FunctionType* l_exit_type     = FunctionType::get(l_void_type, ArrayRef<Type*>(l_exit_params, 1), false);
     FunctionType* l_entry_fn_Type = FunctionType::get(l_void_type, false);
@@ -658,103 +675,159 @@ void insert_entry_boilerplate(T2L_Context& c, Function* l_main) {
     c.builder.CreateRetVoid();
 }
 
-void T2L_Context::compile_all(HeapJob *after) {
-    llvm::Function* llvm_main_fn;
-
-    for (auto &kvp : tir_context.global_valmap) {
-        AST_Var *var = (AST_Var*)kvp.key;
-        if (!(var IS AST_VAR))
-            continue;
+T2L_FunctionContext *T2L_Context::get_function(TIR_Function *tir_fn) {
+    T2L_FunctionContext *llvmfnctx;
+    if (global_functions.find(tir_fn->ast_fn, &llvmfnctx))
+        return llvmfnctx;
 
-        if (var->is_constant)
-            continue;
+    llvmfnctx = new T2L_FunctionContext();
+    llvmfnctx->t2l_context = this;
+    llvmfnctx->tir_fn = tir_fn;
+    llvmfnctx->compile_header();
 
-        llvm::Type* l_type = get_llvm_type(var->type);
+    global_functions[tir_fn->ast_fn] = llvmfnctx;
+    return llvmfnctx;
+}
 
-        TIR_Value initial_value;
-        llvm::Constant *llvm_initial_value;
+// Globals are created the first time a function uses them.
+// Their initial values are only known after the global initializers have run, see finish()
+llvm::Value *T2L_Context::get_global(TIR_Value tir_val) {
+    llvm::Value *l_var;
+    if (translated_globals.find(tir_val, &l_var))
+        return l_var;
+
+    AST_PointerType *pt = (AST_PointerType*)tir_val.type;
+    llvm::Type* l_type = get_llvm_type(pt->pointed_type);
+
+    l_var = new llvm::GlobalVariable(mod, 
+            l_type, 
+            false, 
+            GlobalValue::InternalLinkage, 
+            llvm::Constant::getNullValue(l_type), 
+            "");
+
+    translated_globals[tir_val] = l_var;
+    return l_var;
+}
 
-        if (tir_context._global_initial_values.find(kvp.value.offset, &initial_value)) {
-            llvm_initial_value = get_constant(this, initial_value);
-        } else {
-            llvm_initial_value = llvm::Constant::getNullValue(l_type);
+struct T2L_LowerFnJob : Job {
+    T2L_Context  *t2l_context;
+    TIR_Function *tir_fn;
+
+    bool run(Message *msg) override {
+        // The calls need the callees' signatures, those are known once their TIR is
+        HeapJob *this_heap_job = nullptr;
+        for (TIR_Block *block : tir_fn->blocks) {
+            for (TIR_Instruction &instr : block->instructions) {
+                if (instr.opcode != TOPC_CALL)
+                    continue;
+
+                HeapJob *callee_job = instr.call.fn->compile_job;
+                if (callee_job && !(callee_job->job()->flags & JOB_DONE)) {
+                    if (!this_heap_job)
+                        this_heap_job = heapify<T2L_LowerFnJob>();
+                    this_heap_job->add_dependency(callee_job, true);
+                }
+            }
         }
+        if (this_heap_job)
+            return false;
 
-        auto l_var = new llvm::GlobalVariable(mod, 
-                l_type, 
-                false, 
-                GlobalValue::WeakAnyLinkage, 
-                llvm_initial_value, 
-                "");
+        T2L_FunctionContext *llvmfnctx = t2l_context->get_function(tir_fn);
+        llvmfnctx->compile();
 
-        translated_globals[kvp.value] = l_var;
+        if (t2l_context->release_lowered) {
+            llvmfnctx->release();
+            tir_fn->release_body();
+            tir_fn->ast_fn->block.release_statements();
+        }
+        return true;
     }
 
-    // TODO this has to go
-    // LLVM should only read the TIR, there's no sane reason for it to touch the AST values
-    // The reason we do this right now is because TIR values are shit and have to be redone
-    // Initialize the global variables
-    /*
-    for (auto& kvp : tir_context.valmap) {
-        AST_Value* ast_value = kvp.key;
-        TIR_Value tir_value = kvp.value;
-
-        assert (ast_value IS AST_VAR);
+    std::wstring get_name() override {
+        std::wostringstream s;
+        s << L"T2L_LowerFnJob<" << tir_fn->ast_fn->name << L">";
+        return s.str();
+    }
 
-        switch (ast_value->nodetype) {
-            case AST_VAR: {
-                AST_Var* var = (AST_Var*)ast_value;
+    T2L_LowerFnJob(T2L_Context *t2l_context, TIR_Function *tir_fn) 
+        : t2l_context(t2l_context), tir_fn(tir_fn), Job(tir_fn->tir_context->global) {}
+};
 
-                if (var->initial_value) {
-                    switch (var->initial_value->nodetype) {
-                        case AST_STRING_LITERAL: {
-                            AST_StringLiteral* str = (AST_StringLiteral*)var->initial_value;
+void T2L_Context::on_fn_demanded(TIR_Function *tir_fn) {
+    T2L_LowerFnJob _lower_job(this, tir_fn);
+    HeapJob *lower_job = _lower_job.heapify<T2L_LowerFnJob>();
 
-                            llvm::Constant* l_val = llvm::ConstantDataArray::getString(lc, str->str, true);
+    lower_job->add_dependency(tir_fn->compile_job, true);
+    tir_context.global.add_job(lower_job);
+}
 
-                            auto l_var = new llvm::GlobalVariable( mod, l_val->getType(), true, GlobalValue::WeakAnyLinkage, l_val, "");
+// Adds the functions and globals that c refers to, looking through constant expressions
+static void mark_referenced(llvm::Constant *c, map<llvm::GlobalValue*, bool> &live, arr<llvm::GlobalValue*> &worklist) {
+    if (llvm::GlobalValue *gv = llvm::dyn_cast<llvm::GlobalValue>(c)) {
+        if (live.insert(gv, true))
+            worklist.push(gv);
+        return;
+    }
+    for (llvm::Use &op : c->operands())
+        mark_referenced(llvm::cast<llvm::Constant>(op.get()), live, worklist);
+}
 
-                            translated_globals[tir_value] = l_var;
-                            break;
-                        }
-                        default:
-                            assert(!"Not supported");
-                    }
-                }
-                else {
-                    llvm::Type* l_type = get_llvm_type(var->type);
+// Without --demand-driven every function gets lowered, including the ones nothing calls.
+// Whatever isn't reachable from a symbol with external linkage is erased,
+// which also takes out dead recursive functions and dead cycles that still use each other
+void T2L_Context::strip_dead_symbols() {
+    map<llvm::GlobalValue*, bool> live;
+    arr<llvm::GlobalValue*> worklist;
+
+    for (llvm::GlobalObject &gv : mod.global_objects())
+        if (!gv.hasLocalLinkage() && live.insert(&gv, true))
+            worklist.push(&gv);
+
+    while (worklist.size) {
+        llvm::GlobalValue *gv = worklist.pop();
+
+        if (llvm::Function *l_fn = llvm::dyn_cast<llvm::Function>(gv)) {
+            for (llvm::BasicBlock &bb : *l_fn)
+                for (llvm::Instruction &inst : bb)
+                    for (llvm::Use &op : inst.operands())
+                        if (llvm::Constant *c = llvm::dyn_cast<llvm::Constant>(op.get()))
+                            mark_referenced(c, live, worklist);
+        } else if (llvm::GlobalVariable *l_var = llvm::dyn_cast<llvm::GlobalVariable>(gv)) {
+            if (l_var->hasInitializer())
+                mark_referenced(l_var->getInitializer(), live, worklist);
+        }
+    }
 
-                    auto l_var = new llvm::GlobalVariable( mod, l_type, false, GlobalValue::WeakAnyLinkage, llvm::Constant::getNullValue(l_type), "");
-                    translated_globals[tir_value] = l_var;
-                }
+    // The dead symbols can still refer to each other,
+    // so all their references are dropped before any of them is erased
+    arr<llvm::GlobalObject*> dead;
+    for (llvm::GlobalObject &gv : mod.global_objects()) {
+        if (!live.find2(&gv)) {
+            gv.dropAllReferences();
+            dead.push(&gv);
+        }
+    }
+    for (llvm::GlobalObject *gv : dead)
+        gv->eraseFromParent();
+}
 
-                break;
-            }
+void T2L_Context::finish() {
+    llvm::Function* llvm_main_fn;
 
-            case AST_FN: {
-                continue;
-            }
+    for (auto &kvp : tir_context.global_valmap) {
+        llvm::Value *l_var;
+        TIR_Value initial_value;
 
-            default:
-                NOT_IMPLEMENTED();
+        if (translated_globals.find(kvp.value, &l_var) 
+                && tir_context._global_initial_values.find(kvp.value.offset, &initial_value)) {
+            ((llvm::GlobalVariable*)l_var)->setInitializer(get_constant(this, initial_value));
         }
     }
-    */
 
-    // Compile the signatures for all global functions so we can call them
-    for (auto& kvp : tir_context.fns) {
-        T2L_FunctionContext* llvmfnctx = new T2L_FunctionContext();
-        llvmfnctx->t2l_context = this;
-        llvmfnctx->tir_fn = kvp.value;
-        llvmfnctx->compile_header();
+    strip_dead_symbols();
 
-        this->global_functions[kvp.key] = llvmfnctx;
-    }
-
-    // Compile the bodies for all global functions
     for (auto& kvp : global_functions) {
-        kvp.value->compile();
-
         const char* fn_name = kvp.value->tir_fn->ast_fn->name;
         if (!strcmp(fn_name, "main"))
             llvm_main_fn = kvp.value->llvm_fn;
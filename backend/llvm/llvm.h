@@ -36,24 +36,36 @@ struct T2L_Context;
 struct T2L_FunctionContext;
 struct T2L_BlockContext;
 
-struct T2L_Context {
+// Every demanded function gets a T2L_LowerFnJob that runs as soon as its TIR is ready,
+// so lowering overlaps with the rest of the front end. finish() emits what's left once all jobs are done
+struct T2L_Context : TIR_Consumer {
     TIR_Context& tir_context;
 
     llvm::LLVMContext lc;
     llvm::Module mod;
 
-    map<AST_Type*, llvm::Type*> translated_types;
+    // Indexed by the type's ID in the TypeTable, nullptr if we haven't translated the type yet
+    arr<llvm::Type*> translated_types;
     map<TIR_Value, llvm::Value*> translated_globals;
 
     // TODO this should map TIR_Functions to llvm fns
     map<AST_Fn*, T2L_FunctionContext*> global_functions;
 
+    // If nothing else needs the TIR and AST of a function after it's been lowered, they're freed
+    bool release_lowered = false;
+
     llvm::IRBuilder<> builder;
 
     T2L_Context(TIR_Context& t_c);
-    void compile_all(HeapJob *after);
+    void on_fn_demanded(TIR_Function *tir_fn) override;
+    void finish();
+    void strip_dead_symbols();
     const char* output_object();
 
+    T2L_FunctionContext *get_function(TIR_Function *tir_fn);
+    llvm::Value *get_global(TIR_Value tir_val);
+
+    llvm::Type *&translated_type(AST_Type *type);
     llvm::Type *get_llvm_type(AST_Type *type);
     llvm::FunctionType *get_function_type(TIR_Function *fn);
 };
@@ -70,6 +82,7 @@ struct T2L_FunctionContext {
 
     void compile_header();
     void compile();
+    void release();
 };
 
 struct T2L_BlockContext {
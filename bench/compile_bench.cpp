@@ -0,0 +1,166 @@
+// End to end compile throughput across a sweep of generated programs
+//
+//     neutron_compile_bench [workload options] [--sizes 1,2,4,8,16] [--runs 3] [--dir <dir>]
+//                           [--neutron <path>] [--out <file.json>] [-- <extra neutron arguments>]
+//
+// For every size the functions and structs per file are multiplied by it, the program is
+// generated in --dir, and neutron --timings is run on it --runs times. The fastest run is kept.
+//
+// The table on stderr has the time of every phase and the lines per second.
+// growth is how the total time scaled with the number of lines since the previous size:
+// ~1 is linear, ~2 means something is quadratic.
+// The same numbers are written to stdout, or to --out, as JSON:
+//
+//     {"sizes":[{"size":1,"lines":1372,"total_ms":9.120,"lines_per_sec":150438,
+//                "phases":{"read":0.101,"parse":1.203,"jobs":7.420}}, ...]}
+//
+// Arguments after -- go to neutron, -o out.o runs the backend too.
+// neutron always writes its object file to output.o in the current directory
+
+#include "workload.h"
+#include "neutron_run.h"
+#include <math.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#   include <direct.h>
+#   define make_dir(path) _mkdir(path)
+#else
+#   include <sys/stat.h>
+#   define make_dir(path) mkdir(path, 0755)
+#endif
+
+struct SizeResult {
+    u32 size;
+    NeutronRun run;
+};
+
+void print_row(SizeResult &r, SizeResult *prev) {
+    NeutronRun &run = r.run;
+    fprintf(stderr, "%6u %9llu %10.3f %11.0f", r.size, (unsigned long long)run.lines, run.total_ms, run.lines / run.total_ms * 1000);
+    for (NeutronPhase &ph : run.phases)
+        fprintf(stderr, "  %s %.3f", ph.name, ph.ms);
+
+    if (prev && run.lines > prev->run.lines)
+        fprintf(stderr, "  growth %.2f", log(run.total_ms / prev->run.total_ms) / log((double)run.lines / prev->run.lines));
+    fprintf(stderr, "\n");
+}
+
+std::string results_to_json(arr<SizeResult> &results) {
+    std::string out = "{\"sizes\":[";
+    char buf[256];
+
+    for (u32 i = 0; i < results.size; i++) {
+        NeutronRun &r = results[i].run;
+        if (i)
+            out += ",";
+
+        snprintf(buf, sizeof(buf), "\n{\"size\":%u,\"lines\":%llu,\"total_ms\":%.3f,\"lines_per_sec\":%.0f,\"phases\":{",
+                 results[i].size, (unsigned long long)r.lines, r.total_ms, r.lines / r.total_ms * 1000);
+        out += buf;
+
+        for (u32 j = 0; j < r.phases.size; j++) {
+            snprintf(buf, sizeof(buf), "%s\"%s\":%.3f", j ? "," : "", r.phases[j].name, r.phases[j].ms);
+            out += buf;
+        }
+        out += "}}";
+    }
+    out += "\n]}\n";
+    return out;
+}
+
+int main(int argc, const char **argv) {
+    WorkloadParams base;
+    arr<u32> sizes;
+    u32 runs = 3;
+    std::string dir = "neutron_workload";
+    std::string neutron = NEUTRON_PATH;
+    std::string extra_args;
+    const char *out_file = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        int used = parse_workload_option(base, argc, argv, i);
+        if (used < 0)
+            return 1;
+
+        if (used) {
+            i += used - 1;
+        } else if (!strcmp(argv[i], "--sizes") && i + 1 < argc) {
+            for (const char *s = argv[++i]; *s; s++) {
+                sizes.push((u32)strtoul(s, (char**)&s, 10));
+                if (!*s)
+                    break;
+            }
+        } else if (!strcmp(argv[i], "--runs") && i + 1 < argc) {
+            runs = (u32)strtoul(argv[++i], nullptr, 10);
+        } else if (!strcmp(argv[i], "--dir") && i + 1 < argc) {
+            dir = argv[++i];
+        } else if (!strcmp(argv[i], "--neutron") && i + 1 < argc) {
+            neutron = argv[++i];
+        } else if (!strcmp(argv[i], "--out") && i + 1 < argc) {
+            out_file = argv[++i];
+        } else if (!strcmp(argv[i], "--")) {
+            for (i++; i < argc; i++)
+                extra_args += std::string(" \"") + argv[i] + "\"";
+        } else {
+            fprintf(stderr, "usage: %s [workload options] [--sizes 1,2,4,8,16] [--runs 3] [--dir <dir>]\n"
+                            "       [--neutron <path>] [--out <file.json>] [-- <extra neutron arguments>]\n", argv[0]);
+            print_workload_options(stderr);
+            return 1;
+        }
+    }
+
+    if (sizes.size == 0)
+        sizes = { 1, 2, 4, 8, 16 };
+    if (runs == 0)
+        runs = 1;
+
+    // It's fine if it already exists, generate_workload complains if it can't write to it
+    make_dir(dir.c_str());
+
+    arr<SizeResult> results;
+    fprintf(stderr, "%6s %9s %10s %11s  phases (ms)\n", "size", "lines", "total ms", "lines/s");
+
+    for (u32 size : sizes) {
+        WorkloadParams params = base;
+        params.fns     *= size;
+        params.structs *= size;
+
+        arr<std::string> paths;
+        std::string prefix = dir + "/size" + std::to_string(size) + "_";
+        if (!generate_workload(params, prefix, paths))
+            return 1;
+
+        std::string command = "\"" + neutron + "\" --timings" + extra_args;
+        for (std::string &path : paths)
+            command += " \"" + path + "\"";
+        command += " 2>&1";
+
+        SizeResult best = {};
+        for (u32 run = 0; run < runs; run++) {
+            NeutronRun r;
+            if (!run_neutron(command, r))
+                return 1;
+            if (run == 0 || r.total_ms < best.run.total_ms)
+                best.run = std::move(r);
+        }
+        best.size = size;
+
+        results.push(std::move(best));
+        print_row(results.last(), results.size > 1 ? &results[results.size - 2] : nullptr);
+    }
+
+    std::string json = results_to_json(results);
+    if (out_file) {
+        FILE *f = fopen(out_file, "wb");
+        if (!f) {
+            fprintf(stderr, "couldn't open %s\n", out_file);
+            return 1;
+        }
+        fwrite(json.data(), 1, json.size(), f);
+        fclose(f);
+    } else {
+        fwrite(json.data(), 1, json.size(), stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,303 @@
+// Microbenchmarks for the containers in ds.h
+//
+//     neutron_bench [--filter <substring>] [--out <file.json>] [--min-time <ms>]
+//
+// Every benchmark is run until it has taken at least --min-time (100ms by default),
+// and the results are written to stdout, or to --out, as a single JSON object:
+//
+//     {"benchmarks":[{"name":"map<const char*>.find_hit","n":10649,"load_factor":0.65,
+//                     "iterations":812,"ops":10649,"ns_per_op":11.52}, ...]}
+//
+// ops is the number of operations in one iteration, load_factor is only there for the map benchmarks.
+// Compare ns_per_op between runs of release builds to spot regressions
+
+#include "../common.h"
+#include "../ds.h"
+#include "../context.h"
+#include "../tir.h"
+
+#include <chrono>
+#include <string>
+#include <stdio.h>
+
+struct BenchResult {
+    std::string name;
+    u64 n;
+    double load_factor;
+    u64 iterations;
+    u64 ops;
+    double ns_per_op;
+};
+
+static arr<BenchResult> results;
+static const char *filter = nullptr;
+static u64 min_time_ns = 100 * 1000 * 1000;
+
+// Results are folded into this so the compiler can't throw the benchmarked work away
+static volatile u64 sink;
+
+// Runs one iteration of fn, doing ops_per_iter operations, until min_time_ns has passed
+template <typename F>
+void bench(const std::string &name, u64 n, u64 ops_per_iter, double load_factor, F fn) {
+    if (filter && name.find(filter) == std::string::npos)
+        return;
+
+    using Clock = std::chrono::steady_clock;
+
+    // One warm up iteration, so the first one doesn't pay for page faults
+    fn();
+
+    u64 iterations = 0;
+    u64 elapsed = 0;
+    Clock::time_point start = Clock::now();
+    do {
+        fn();
+        iterations++;
+        elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    } while (elapsed < min_time_ns);
+
+    results.push({ name, n, load_factor, iterations, ops_per_iter, (double)elapsed / (iterations * ops_per_iter) });
+    fprintf(stderr, "%-48s n=%-8llu %10.2f ns/op\n", name.c_str(), (unsigned long long)n, results.last().ns_per_op);
+}
+
+
+// Keys for the map benchmarks. Each one makes the i-th key of its kind;
+// keys made from indices >= the map's size are used for the lookups that miss
+
+struct KeyStore {
+    linear_alloc alloc;
+    arr<const char*> names;
+
+    // Identifier-like names, as the parser interns them
+    const char *name(u32 i) {
+        while (names.size <= i) {
+            char buf[32];
+            int len = snprintf(buf, sizeof(buf), "identifier_%u", names.size);
+            char *s = alloc.alloc(len + 1, 1);
+            memcpy(s, buf, len + 1);
+            names.push(s);
+        }
+        return names[i];
+    }
+
+    ~KeyStore() { alloc.free_all(); }
+} keys;
+
+// Pointers spaced like AST nodes coming out of the linear allocator
+static char *fake_nodes = (char*)0x7f0000100000;
+
+template <typename K> K make_key(u32 i);
+
+template <> const char *make_key(u32 i) { return keys.name(i); }
+template <> void       *make_key(u32 i) { return fake_nodes + i * 48; }
+
+// Every name is overloaded 4 times, like the operator and overload declarations.
+// The function types are never dereferenced, only hashed and compared
+template <> DeclarationKey make_key(u32 i) {
+    return { .name = keys.name(i / 4), .fn_type = (AST_FnType*)(fake_nodes + (i % 4) * 64) };
+}
+
+// Temporaries of 8 bytes each, like the ones the TIR builder allocates
+template <> TIR_Value make_key(u32 i) {
+    return { .valuespace = TVS_TEMP, .offset = (u64)i * 8, .type = nullptr };
+}
+
+template <typename K>
+void bench_map(const char *key_name) {
+    std::string prefix = std::string("map<") + key_name + ">.";
+
+    // Growing from the default size, the way most maps in the compiler are filled
+    for (u32 n : { 16u, 1024u, 65536u }) {
+        arr<K> ks;
+        for (u32 i = 0; i < n; i++)
+            ks.push(make_key<K>(i));
+
+        bench(prefix + "insert", n, n, -1, [&]() {
+            map<K, u64> m;
+            for (K &k : ks)
+                m.insert(k, 1);
+            sink = sink + m.numbins;
+        });
+    }
+
+    // A map that's never grown, filled to the given load factor.
+    // The map grows when it goes past 0.65
+    const u32 numbins = 16384;
+    for (double lf : { 0.25, 0.50, 0.65 }) {
+        u32 n = (u32)(numbins * lf);
+
+        map<K, u64> m(numbins);
+        arr<K> hits, misses;
+        for (u32 i = 0; i < n; i++) {
+            hits.push(make_key<K>(i));
+            misses.push(make_key<K>(i + n));
+            m.insert(hits[i], i);
+        }
+
+        bench(prefix + "find_hit", n, n, lf, [&]() {
+            u64 sum = 0, v;
+            for (K &k : hits)
+                if (m.find(k, &v))
+                    sum += v;
+            sink = sink + sum;
+        });
+
+        bench(prefix + "find_miss", n, n, lf, [&]() {
+            u64 sum = 0, v;
+            for (K &k : misses)
+                if (m.find(k, &v))
+                    sum += v;
+            sink = sink + sum;
+        });
+
+        bench(prefix + "iterate", n, n, lf, [&]() {
+            u64 sum = 0;
+            for (auto &kvp : m)
+                sum += kvp.value;
+            sink = sink + sum;
+        });
+    }
+}
+
+void bench_arr() {
+    for (u32 n : { 16u, 1024u, 65536u }) {
+        bench("arr<u64>.push", n, n, -1, [&]() {
+            arr<u64> a;
+            for (u32 i = 0; i < n; i++)
+                a.push(i);
+            sink = sink + a.size;
+        });
+
+        bench("arr<TIR_Value>.push", n, n, -1, [&]() {
+            arr<TIR_Value> a;
+            for (u32 i = 0; i < n; i++)
+                a.push(make_key<TIR_Value>(i));
+            sink = sink + a.size;
+        });
+
+        // Used as a stack, like the job queue and the interpreter's frames
+        arr<u64> stack;
+        bench("arr<u64>.push_pop", n, n * 2, -1, [&]() {
+            u64 sum = 0;
+            for (u32 i = 0; i < n; i++)
+                stack.push(i);
+            for (u32 i = 0; i < n; i++)
+                sum += stack.pop();
+            sink = sink + sum;
+        });
+    }
+}
+
+void bench_bucketed_arr() {
+    // 4 fits inline, 64 and up spread over the doubling buckets
+    for (u32 n : { 4u, 64u, 4096u, 65536u }) {
+        bench("bucketed_arr<u64>.push", n, n, -1, [&]() {
+            bucketed_arr<u64> a;
+            for (u32 i = 0; i < n; i++)
+                a.push(i);
+            sink = sink + a.size;
+        });
+
+        bucketed_arr<u64> a;
+        for (u32 i = 0; i < n; i++)
+            a.push(i);
+
+        bench("bucketed_arr<u64>.iterate", n, n, -1, [&]() {
+            u64 sum = 0;
+            for (u64 x : a)
+                sum += x;
+            sink = sink + sum;
+        });
+
+        bench("bucketed_arr<u64>.index", n, n, -1, [&]() {
+            u64 sum = 0;
+            for (u32 i = 0; i < a.size; i++)
+                sum += a[i];
+            sink = sink + sum;
+        });
+    }
+}
+
+void bench_linear_alloc() {
+    for (u32 n : { 1024u, 65536u, 1048576u }) {
+        // Many small node-sized allocations, then everything is released at once
+        bench("linear_alloc.alloc_48", n, n, -1, [&]() {
+            linear_alloc alloc;
+            for (u32 i = 0; i < n; i++)
+                sink = sink + (uintptr_t)alloc.alloc(48, 8);
+            alloc.free_all();
+        });
+
+        // The temporary allocator is rewound after every use, so it keeps reusing the same blocks
+        linear_alloc alloc;
+        bench("linear_alloc.alloc_rewind", n, n, -1, [&]() {
+            linear_alloc_scope scope(alloc);
+            for (u32 i = 0; i < n; i++)
+                sink = sink + (uintptr_t)alloc.alloc(48, 8);
+        });
+        alloc.free_all();
+    }
+}
+
+std::string results_to_json() {
+    std::string out = "{\"benchmarks\":[";
+    char buf[128];
+
+    for (u32 i = 0; i < results.size; i++) {
+        BenchResult &r = results[i];
+        if (i)
+            out += ",";
+        out += "\n{\"name\":\"" + r.name + "\"";
+
+        snprintf(buf, sizeof(buf), ",\"n\":%llu", (unsigned long long)r.n);
+        out += buf;
+        if (r.load_factor >= 0) {
+            snprintf(buf, sizeof(buf), ",\"load_factor\":%.2f", r.load_factor);
+            out += buf;
+        }
+        snprintf(buf, sizeof(buf), ",\"iterations\":%llu,\"ops\":%llu,\"ns_per_op\":%.3f}",
+                 (unsigned long long)r.iterations, (unsigned long long)r.ops, r.ns_per_op);
+        out += buf;
+    }
+    out += "\n]}\n";
+    return out;
+}
+
+int main(int argc, const char **argv) {
+    const char *out_file = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--filter") && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (!strcmp(argv[i], "--out") && i + 1 < argc) {
+            out_file = argv[++i];
+        } else if (!strcmp(argv[i], "--min-time") && i + 1 < argc) {
+            min_time_ns = strtoull(argv[++i], nullptr, 10) * 1000 * 1000;
+        } else {
+            fprintf(stderr, "usage: %s [--filter <substring>] [--out <file.json>] [--min-time <ms>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    bench_map<const char*>("const char*");
+    bench_map<void*>("void*");
+    bench_map<DeclarationKey>("DeclarationKey");
+    bench_map<TIR_Value>("TIR_Value");
+    bench_arr();
+    bench_bucketed_arr();
+    bench_linear_alloc();
+
+    std::string json = results_to_json();
+    if (out_file) {
+        FILE *f = fopen(out_file, "wb");
+        if (!f) {
+            fprintf(stderr, "couldn't open %s\n", out_file);
+            return 1;
+        }
+        fwrite(json.data(), 1, json.size(), f);
+        fclose(f);
+    } else {
+        fwrite(json.data(), 1, json.size(), stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,37 @@
+// Writes a synthetic .n program, to look at how the compiler handles inputs of a known shape
+//
+//     neutron_gen [workload options] [--out <prefix>]
+//
+// The files are named <prefix>0.n, <prefix>1.n, ... (workload_0.n, workload_1.n by default),
+// their paths are printed one per line so they can be passed straight to neutron
+
+#include "workload.h"
+
+int main(int argc, const char **argv) {
+    WorkloadParams params;
+    std::string prefix = "workload_";
+
+    for (int i = 1; i < argc; i++) {
+        int used = parse_workload_option(params, argc, argv, i);
+        if (used < 0)
+            return 1;
+
+        if (used) {
+            i += used - 1;
+        } else if (!strcmp(argv[i], "--out") && i + 1 < argc) {
+            prefix = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [options] [--out <prefix>]\n", argv[0]);
+            print_workload_options(stderr);
+            return 1;
+        }
+    }
+
+    arr<std::string> paths;
+    if (!generate_workload(params, prefix, paths))
+        return 1;
+
+    for (std::string &path : paths)
+        printf("%s\n", path.c_str());
+    return 0;
+}
@@ -0,0 +1,119 @@
+// How fast the TIR interpreter runs the programs in bench/interp
+//
+//     neutron_interp_bench [--runs 5] [--neutron <path>] [--out <file.json>] [<program.n>...]
+//
+// Every program is run with neutron -e --timings --runs times and the fastest run is kept.
+// exec_ms is the time spent in the interpreter, total_ms includes compiling the program.
+// What main returned is kept too, a change in it means the interpreter broke, not that it got faster.
+// The results go to stdout, or to --out, as JSON:
+//
+//     {"programs":[{"name":"fib.n","exec_ms":226.655,"total_ms":227.310,"result":196418}, ...]}
+//
+// To see where the time goes in one of them, run neutron -e --tir-stats on it
+
+#include "neutron_run.h"
+#include <stdlib.h>
+
+// Set by CMake to bench/interp in the source tree
+#ifndef NEUTRON_INTERP_DIR
+#   define NEUTRON_INTERP_DIR "bench/interp"
+#endif
+
+static const char *default_programs[] = {
+    "fib.n",
+    "loops.n",
+    "calls.n",
+    "arith.n",
+};
+
+struct ProgramResult {
+    std::string name;
+    NeutronRun run;
+};
+
+std::string results_to_json(arr<ProgramResult> &results) {
+    std::string out = "{\"programs\":[";
+    char buf[256];
+
+    for (u32 i = 0; i < results.size; i++) {
+        ProgramResult &r = results[i];
+        if (i)
+            out += ",";
+
+        out += "\n{\"name\":\"" + r.name + "\"";
+        snprintf(buf, sizeof(buf), ",\"exec_ms\":%.3f,\"total_ms\":%.3f,\"result\":%lld}",
+                 r.run.phase_ms("exec"), r.run.total_ms, (long long)r.run.result);
+        out += buf;
+    }
+    out += "\n]}\n";
+    return out;
+}
+
+int main(int argc, const char **argv) {
+    u32 runs = 5;
+    std::string neutron = NEUTRON_PATH;
+    const char *out_file = nullptr;
+    arr<std::string> paths;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--runs") && i + 1 < argc) {
+            runs = (u32)strtoul(argv[++i], nullptr, 10);
+        } else if (!strcmp(argv[i], "--neutron") && i + 1 < argc) {
+            neutron = argv[++i];
+        } else if (!strcmp(argv[i], "--out") && i + 1 < argc) {
+            out_file = argv[++i];
+        } else if (argv[i][0] == '-') {
+            fprintf(stderr, "usage: %s [--runs 5] [--neutron <path>] [--out <file.json>] [<program.n>...]\n", argv[0]);
+            return 1;
+        } else {
+            paths.push(argv[i]);
+        }
+    }
+
+    if (paths.size == 0)
+        for (const char *name : default_programs)
+            paths.push(std::string(NEUTRON_INTERP_DIR) + "/" + name);
+    if (runs == 0)
+        runs = 1;
+
+    arr<ProgramResult> results;
+    fprintf(stderr, "%-16s %10s %10s  %s\n", "program", "exec ms", "total ms", "result");
+
+    for (std::string &path : paths) {
+        std::string command = "\"" + neutron + "\" -e --timings \"" + path + "\" 2>&1";
+
+        ProgramResult best = {};
+        for (u32 run = 0; run < runs; run++) {
+            NeutronRun r;
+            if (!run_neutron(command, r))
+                return 1;
+            if (!r.has_result) {
+                fprintf(stderr, "%s didn't return anything\n", path.c_str());
+                return 1;
+            }
+            if (run == 0 || r.phase_ms("exec") < best.run.phase_ms("exec"))
+                best.run = std::move(r);
+        }
+
+        size_t slash = path.find_last_of("/\\");
+        best.name = slash == std::string::npos ? path : path.substr(slash + 1);
+
+        fprintf(stderr, "%-16s %10.3f %10.3f  %lld\n", best.name.c_str(),
+                best.run.phase_ms("exec"), best.run.total_ms, (long long)best.run.result);
+        results.push(std::move(best));
+    }
+
+    std::string json = results_to_json(results);
+    if (out_file) {
+        FILE *f = fopen(out_file, "wb");
+        if (!f) {
+            fprintf(stderr, "couldn't open %s\n", out_file);
+            return 1;
+        }
+        fwrite(json.data(), 1, json.size(), f);
+        fclose(f);
+    } else {
+        fwrite(json.data(), 1, json.size(), stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include "neutron_run.h"
+
+#ifdef _WIN32
+#   define popen  _popen
+#   define pclose _pclose
+#endif
+
+double NeutronRun::phase_ms(const char *name) {
+    for (NeutronPhase &ph : phases)
+        if (!strcmp(ph.name, name))
+            return ph.ms;
+    return 0;
+}
+
+bool run_neutron(const std::string &command, NeutronRun &run) {
+    FILE *p = popen(command.c_str(), "r");
+    if (!p) {
+        fprintf(stderr, "couldn't run %s\n", command.c_str());
+        return false;
+    }
+
+    std::string output;
+    bool in_timings = false;
+    char line[1024];
+
+    run.phases = arr<NeutronPhase>();
+    run.total_ms = 0;
+    run.lines = 0;
+    run.has_result = false;
+    run.result = 0;
+
+    while (fgets(line, sizeof(line), p)) {
+        output += line;
+
+        long long result;
+        if (sscanf(line, "main returned %lld", &result) == 1) {
+            run.has_result = true;
+            run.result = result;
+            continue;
+        }
+
+        if (!strncmp(line, "--------- Timings", 17)) {
+            in_timings = true;
+            continue;
+        }
+        if (!in_timings)
+            continue;
+
+        NeutronPhase ph;
+        unsigned long long lines;
+
+        if (sscanf(line, "%31s %lf ms", ph.name, &ph.ms) == 2) {
+            if (!strcmp(ph.name, "total"))
+                run.total_ms = ph.ms;
+            else
+                run.phases.push(ph);
+        } else if (sscanf(line, "%llu lines", &lines) == 1) {
+            run.lines = lines;
+        }
+    }
+
+    if (pclose(p) != 0 || !run.total_ms) {
+        fprintf(stderr, "neutron failed:\n%s\n", output.c_str());
+        return false;
+    }
+    return true;
+}
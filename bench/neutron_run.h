@@ -0,0 +1,36 @@
+#ifndef NEUTRON_RUN_H
+#define NEUTRON_RUN_H
+
+#include "../common.h"
+#include "../ds.h"
+#include <string>
+
+// Set by CMake to the neutron that's built next to the benchmarks
+#ifndef NEUTRON_PATH
+#   define NEUTRON_PATH "neutron"
+#endif
+
+struct NeutronPhase {
+    char name[32];
+    double ms;
+};
+
+// What neutron --timings printed
+struct NeutronRun {
+    u64 lines;
+    double total_ms;
+    arr<NeutronPhase> phases;
+
+    // The value after "main returned", when it's run with -e
+    bool has_result;
+    i64 result;
+
+    // 0 if there's no such phase
+    double phase_ms(const char *name);
+};
+
+// Runs the command, which must include --timings and redirect stderr to stdout,
+// and picks the timings out of its output. Prints the output and returns false if neutron fails
+bool run_neutron(const std::string &command, NeutronRun &run);
+
+#endif // guard
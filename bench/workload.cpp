@@ -0,0 +1,267 @@
+#include "workload.h"
+#include <stdlib.h>
+
+// The call graph and the struct nesting must not have cycles, so every function and struct
+// gets a level and only refers to things of a lower level. Level 0 functions don't call anything.
+// This keeps the number of calls main makes when it runs under CALLS_PER_FN ^ LEVELS
+static const u32 LEVELS = 8;
+static const u32 CALLS_PER_FN = 2;
+
+struct Generator {
+    WorkloadParams &p;
+    u64 state;
+
+    arr<u8> fn_levels;
+    arr<u8> struct_levels;
+
+    Generator(WorkloadParams &p) : p(p), state(p.seed * 0x9E3779B97F4A7C15ull + 1) {}
+
+    // xorshift64*, the output has to be the same on every platform for a given seed
+    u32 next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return (u32)((state * 0x2545F4914F6CDD1Dull) >> 32);
+    }
+
+    u32 below(u32 n) { return next() % n; }
+    bool chance(u32 percent) { return below(100) < percent; }
+
+    // Picks something of a lower level than levels[self], declared after self if forward is set.
+    // Returns -1 if there's nothing like that
+    i64 pick_lower(arr<u8> &levels, u32 self, bool forward) {
+        u32 lo = forward ? self + 1 : 0;
+        u32 hi = forward ? levels.size : self;
+
+        if (lo >= hi || levels[self] == 0)
+            return -1;
+
+        for (u32 attempt = 0; attempt < 16; attempt++) {
+            u32 i = lo + below(hi - lo);
+            if (levels[i] < levels[self])
+                return i;
+        }
+        return -1;
+    }
+
+    i64 pick(arr<u8> &levels, u32 self) {
+        bool forward = chance(p.forward_refs);
+        i64 i = pick_lower(levels, self, forward);
+        return i >= 0 ? i : pick_lower(levels, self, !forward);
+    }
+
+    std::string fn_name(u32 index) {
+        return "f" + std::to_string(index / p.fns) + "_" + std::to_string(index % p.fns);
+    }
+
+    std::string struct_name(u32 index) {
+        return "S" + std::to_string(index / p.structs) + "_" + std::to_string(index % p.structs);
+    }
+
+    std::string literal() {
+        return std::to_string(1 + below(99));
+    }
+
+    std::string param(u32 arity) {
+        return "a" + std::to_string(below(arity));
+    }
+
+    // A call to one of the overloads of the function at index, with arguments picked by make_arg
+    template <typename F>
+    std::string call(u32 index, F make_arg) {
+        u32 arity = 1 + below(p.overloads);
+        std::string s = fn_name(index) + "(";
+        for (u32 i = 0; i < arity; i++) {
+            if (i)
+                s += ", ";
+            s += make_arg();
+        }
+        return s + ")";
+    }
+
+    // Nests depth binary operators, one side of each is a leaf.
+    // The innermost operand is a typed_leaf: there are no operators on two number literals,
+    // so every operator needs one operand that isn't a literal.
+    //
+    // The operands are generated in separate statements, the order in which
+    // the operands of + are evaluated would change the output between compilers
+    template <typename F, typename G>
+    std::string expr(u32 depth, F leaf, G typed_leaf) {
+        if (depth == 0)
+            return typed_leaf();
+
+        static const char *ops[] = { " + ", " - ", " * " };
+        const char *op = ops[below(3)];
+
+        bool nested_on_left = below(2);
+        std::string lhs = nested_on_left ? expr(depth - 1, leaf, typed_leaf) : leaf();
+        std::string rhs = nested_on_left ? leaf() : expr(depth - 1, leaf, typed_leaf);
+        return "(" + lhs + op + rhs + ")";
+    }
+
+    void gen_fn(std::string &out, u32 index, u32 arity) {
+        out += "fn " + fn_name(index) + "(";
+        for (u32 i = 0; i < arity; i++) {
+            if (i)
+                out += ", ";
+            out += "a" + std::to_string(i) + ": u32";
+        }
+        out += "): u32 {\n";
+
+        u32 calls_left = CALLS_PER_FN;
+        auto simple_leaf = [&]() { return below(2) ? param(arity) : literal(); };
+
+        auto typed_leaf = [&]() -> std::string {
+            if (calls_left && below(3) == 0) {
+                calls_left--;
+                i64 callee = pick(fn_levels, index);
+                if (callee >= 0)
+                    return call(callee, simple_leaf);
+            }
+            return param(arity);
+        };
+        auto leaf = [&]() { return below(3) ? typed_leaf() : literal(); };
+
+        out += "    return " + expr(p.expr_depth, leaf, typed_leaf) + ";\n}\n\n";
+    }
+
+    void gen_struct(std::string &out, u32 index, i64 inner) {
+        out += "struct " + struct_name(index) + " {\n";
+        out += "    a: u32,\n";
+        out += "    b: u32";
+        if (inner >= 0)
+            out += ",\n    inner: " + struct_name(inner);
+        out += "\n}\n\n";
+    }
+
+    // Reads the struct's members, and recurses into the inner struct's function
+    void gen_struct_fn(std::string &out, u32 index, i64 inner) {
+        out += "fn sum_" + struct_name(index) + "(s: " + struct_name(index) + ", a0: u32): u32 {\n";
+
+        auto typed_leaf = [&]() -> std::string {
+            switch (below(3)) {
+                case 0:  return "s.a";
+                case 1:  return "s.b";
+                default: return "a0";
+            }
+        };
+        auto leaf = [&]() { return below(4) ? typed_leaf() : literal(); };
+
+        std::string e = expr(p.expr_depth, leaf, typed_leaf);
+        if (inner >= 0)
+            e += " + sum_" + struct_name(inner) + "(s.inner, a0)";
+        out += "    return " + e + ";\n}\n\n";
+    }
+
+    std::string gen_file(u32 file) {
+        std::string out;
+
+        for (u32 i = 0; i < p.globals && p.fns; i++) {
+            out += "g" + std::to_string(file) + "_" + std::to_string(i) + ": u32 = ";
+            out += call(below(fn_levels.size), [&]() { return literal(); }) + ";\n";
+        }
+        if (p.globals)
+            out += "\n";
+
+        for (u32 i = 0; i < p.structs; i++) {
+            u32 index = file * p.structs + i;
+            i64 inner = pick(struct_levels, index);
+
+            // The struct's function comes before the struct itself when it's a forward reference
+            if (chance(p.forward_refs)) {
+                gen_struct_fn(out, index, inner);
+                gen_struct(out, index, inner);
+            } else {
+                gen_struct(out, index, inner);
+                gen_struct_fn(out, index, inner);
+            }
+        }
+
+        for (u32 i = 0; i < p.fns; i++)
+            for (u32 arity = 1; arity <= p.overloads; arity++)
+                gen_fn(out, file * p.fns + i, arity);
+
+        if (file == 0 && p.fns) {
+            out += "fn main(): u32 {\n    return " + fn_name(0) + "(1)";
+            for (u32 i = 1; i < 4 && i < fn_levels.size; i++) {
+                std::string callee = fn_name(below(fn_levels.size));
+                out += " + " + callee + "(" + literal() + ")";
+            }
+            out += ";\n}\n";
+        }
+        return out;
+    }
+};
+
+bool generate_workload(WorkloadParams &params, const std::string &prefix, arr<std::string> &paths) {
+    if (params.overloads == 0)
+        params.overloads = 1;
+
+    Generator gen(params);
+
+    for (u32 i = 0; i < params.files * params.fns; i++)
+        gen.fn_levels.push((u8)gen.below(LEVELS));
+    for (u32 i = 0; i < params.files * params.structs; i++)
+        gen.struct_levels.push((u8)gen.below(LEVELS));
+
+    for (u32 file = 0; file < params.files; file++) {
+        std::string path = prefix + std::to_string(file) + ".n";
+        std::string source = gen.gen_file(file);
+
+        FILE *f = fopen(path.c_str(), "wb");
+        if (!f) {
+            fprintf(stderr, "couldn't write %s\n", path.c_str());
+            return false;
+        }
+        fwrite(source.data(), 1, source.size(), f);
+        fclose(f);
+
+        paths.push(path);
+    }
+    return true;
+}
+
+int parse_workload_option(WorkloadParams &params, int argc, const char **argv, int i) {
+    struct Option {
+        const char *name;
+        u32 *value;
+    };
+
+    Option options[] = {
+        { "--files",        &params.files },
+        { "--fns",          &params.fns },
+        { "--overloads",    &params.overloads },
+        { "--structs",      &params.structs },
+        { "--forward-refs", &params.forward_refs },
+        { "--expr-depth",   &params.expr_depth },
+        { "--globals",      &params.globals },
+        { "--seed",         &params.seed },
+    };
+
+    for (Option &o : options) {
+        if (strcmp(argv[i], o.name))
+            continue;
+
+        if (i + 1 >= argc) {
+            fprintf(stderr, "missing %s argument\n", o.name);
+            return -1;
+        }
+        *o.value = (u32)strtoul(argv[i + 1], nullptr, 10);
+        return 2;
+    }
+    return 0;
+}
+
+void print_workload_options(FILE *f) {
+    WorkloadParams d;
+    fprintf(f,
+        "    --files <n>          number of files (%u)\n"
+        "    --fns <n>            function names per file, each one is overloaded (%u)\n"
+        "    --overloads <n>      overloads of every function, with 1 to n parameters (%u)\n"
+        "    --structs <n>        structs per file (%u)\n"
+        "    --forward-refs <%%>   percentage of references to things declared later (%u)\n"
+        "    --expr-depth <n>     nesting of the operators in every function (%u)\n"
+        "    --globals <n>        globals with compile time initializers per file (%u)\n"
+        "    --seed <n>           (%u)\n",
+        d.files, d.fns, d.overloads, d.structs, d.forward_refs, d.expr_depth, d.globals, d.seed);
+}
@@ -0,0 +1,43 @@
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#include "../common.h"
+#include "../ds.h"
+
+// Shape of a generated .n program. The counts are per file
+struct WorkloadParams {
+    u32 files = 4;
+
+    // Every function name is declared once with each parameter count from 1 to overloads,
+    // so a file has fns * overloads functions
+    u32 fns = 100;
+    u32 overloads = 2;
+
+    // Every struct gets a function that reads its members
+    u32 structs = 10;
+
+    // Percentage of calls, struct members and struct functions that refer to something
+    // that's declared further down the file or in a later file
+    u32 forward_refs = 50;
+
+    // How deep the binary operators in a function's return expression nest
+    u32 expr_depth = 3;
+
+    // Globals initialized with a call, evaluated at compile time.
+    // The compiler can't compile those yet, so there are none by default
+    u32 globals = 0;
+
+    u32 seed = 1;
+};
+
+// Writes the program to <prefix>0.n, <prefix>1.n, ... and appends their paths to paths.
+// The generated calls never recurse, so running main always terminates
+bool generate_workload(WorkloadParams &params, const std::string &prefix, arr<std::string> &paths);
+
+// Parses the option at argv[i], like "--fns 100", into params.
+// Returns how many arguments it used, 0 if argv[i] isn't a workload option and -1 if it's missing its value
+int parse_workload_option(WorkloadParams &params, int argc, const char **argv, int i);
+
+void print_workload_options(FILE *f);
+
+#endif // guard
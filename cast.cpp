@@ -8,6 +8,16 @@
 u32 map_hash(TypePair pair) { return map_hash(pair.lhs) ^ (map_hash(pair.rhs) << 1); }
 bool map_equals(TypePair a, TypePair b) { return a.lhs == b.lhs && a.rhs == b.rhs; }
 
+CastResolution find_cast(AST_Type *src, AST_Type *dst) {
+    if (src == dst)
+        return { nullptr, 100 };
+
+    BuiltinCast cast;
+    if (builtin_casts.find({ src, dst }, &cast))
+        return { cast.fn, cast.priority };
+    return { nullptr, 0 };
+}
+
 
 CastJob::CastJob(AST_Context *ctx, AST_Value *value, AST_Type *dsttype, JobOnCompleteCallback on_complete)
     : Job (ctx->global), src(value), dsttype(dsttype), prio(0)
@@ -22,23 +32,20 @@ std::wstring CastJob::get_name() {
 }
 
 bool CastJob::run(Message *msg) {
-    if (dsttype == src->type) {
-        prio = 100;
+    CastResolution cast = find_cast(src->type, dsttype);
+
+    if (!cast.priority) {
+        set_error_flag();
+        return false;
+    }
+
+    if (!cast.fn) {
         result = src;
-        return true;
-    } else {
-        BuiltinCast cast;
-        if (!builtin_casts.find({ src->type, dsttype }, &cast)) {
-            set_error_flag();
-            return false;
-        }
-        if (!cast.fn(global, src, (AST_Value**)&result)) {
-            set_error_flag();
-            return false;
-        }
-        prio = cast.priority;
-        return true;
+    } else if (!cast.fn(global, src, (AST_Value**)&result)) {
+        set_error_flag();
+        return false;
     }
-    NOT_IMPLEMENTED();
-    return false;
+
+    prio = cast.priority;
+    return true;
 }
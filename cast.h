@@ -5,9 +5,21 @@
 #include "number.h"
 #include "ast.h"
 #include "typer.h"
+#include "tir_builtins.h"
 
 
 
+// How a value of one type is implicitly cast to another.
+// fn is nullptr if the types are the same and no conversion is needed.
+// priority is 0 if there is no implicit cast between the two types.
+struct CastResolution {
+    BuiltinCastFn fn;
+    int priority;
+};
+
+// A single lookup in builtin_casts, the result doesn't depend on the value being cast
+CastResolution find_cast(AST_Type *src, AST_Type *dst);
+
 struct CastJob : Job {
     AST_Value *src;
     AST_Type  *dsttype;
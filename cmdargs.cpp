@@ -1,10 +1,12 @@
 #include "util.h"
 #include "cmdargs.h"
 
-bool print_llvm, print_tir, print_ast, exec_main, debug_jobs;
+bool print_llvm, print_tir, print_ast, exec_main, debug_jobs, skim_bodies, batch_errors, demand_driven, run_backend, print_timings, tir_stats, profile_cte;
 
 const char* output_file = nullptr;
+const char* profile_cte_folded = nullptr;
 OutputType output_type;
+DiagnosticsFormat diagnostics_format = DIAGNOSTICS_TEXT;
 arr<SourceFile> sources;
 
 #ifdef _WINDOWS
@@ -31,6 +33,13 @@ bool add_source(std::wstring& filename, u32* out) {
 	sf.length = ftell(f);
 	rewind(f);
 
+    // TODO ERROR
+    // Token offsets are stored as u32
+    if (sf.length > UINT32_MAX) {
+		fclose(f);
+		return false;
+    }
+
     // TODO ERROR
 	if (!(sf.buffer = (char*)malloc(sf.length))) {
 		fclose(f);
@@ -76,11 +85,56 @@ bool parse_args(int argc, const char** argv) {
                     }
                     else {
                         output_file = argv[++i];
+                        run_backend = true;
                         continue;
                     }
                 }
                 if (!strcmp(argname, "exec_main")) {
                     exec_main = true;
+                    continue;
+                }
+                if (!strcmp(argname, "skim")) {
+                    skim_bodies = true;
+                    continue;
+                }
+                if (!strcmp(argname, "demand-driven")) {
+                    demand_driven = true;
+                    continue;
+                }
+                if (!strcmp(argname, "batch-errors")) {
+                    batch_errors = true;
+                    continue;
+                }
+                if (!strcmp(argname, "timings")) {
+                    print_timings = true;
+                    continue;
+                }
+                if (!strcmp(argname, "tir-stats")) {
+                    tir_stats = true;
+                    continue;
+                }
+                if (!strcmp(argname, "profile-cte")) {
+                    profile_cte = true;
+                    continue;
+                }
+                if (!strncmp(argname, "profile-cte=", 12)) {
+                    profile_cte = true;
+                    profile_cte_folded = argname + 12;
+                    continue;
+                }
+                if (!strncmp(argname, "diagnostics-format=", 19)) {
+                    const char *format = argname + 19;
+                    if (!strcmp(format, "json")) {
+                        // JSON diagnostics are only written once everything has been collected
+                        diagnostics_format = DIAGNOSTICS_JSON;
+                        batch_errors = true;
+                    } else if (!strcmp(format, "text")) {
+                        diagnostics_format = DIAGNOSTICS_TEXT;
+                    } else {
+                        fprintf(stderr, "unknown diagnostics format '%s'\n", format);
+                        return false;
+                    }
+                    continue;
                 }
             }
             else {
@@ -93,12 +147,14 @@ bool parse_args(int argc, const char** argv) {
                             }
                             else {
                                 output_file = argv[++i];
+                                run_backend = true;
                                 break;
                             }
                             break;
                         }
                         case 'l': {
                             print_llvm = true;
+                            run_backend = true;
                             break;
                         }
                         case 't': {
@@ -117,6 +173,10 @@ bool parse_args(int argc, const char** argv) {
                             exec_main = true;
                             break;
                         }
+                        case 's': {
+                            skim_bodies = true;
+                            break;
+                        }
                         default:
                             assert(!"UNKNOWN FLAG AAAAAAA");
                     }
@@ -173,19 +233,81 @@ bool parse_args(int argc, const char** argv) {
 }
 
 
+#define NO_TOKEN_PAYLOAD ((u32)-1)
+
+SmallToken SourceFile::getSmallToken(u64 tok_id) {
+    u32 payload = _token_payloads[tok_id];
+    return {
+        .type = _token_types[tok_id],
+        .name = payload == NO_TOKEN_PAYLOAD ? nullptr : _token_names[payload],
+    };
+}
+
 Token SourceFile::getToken(u64 tok_id) {
     Token tok;
-    *(SmallToken*)&tok = _tokens[tok_id];
+    *(SmallToken*)&tok = getSmallToken(tok_id);
 
     tok.file_id = id;
     tok.id = tok_id;
-    tok.loc = _token_locations[tok_id];
+    tok.loc = { _token_starts[tok_id], token_end(tok_id) };
 
     return tok;
 }
 
+u64 SourceFile::matching_curly(u64 open_tok_id) {
+    // curly_pairs is sorted by the opening bracket
+    u64 lo = 0, hi = curly_pairs.size;
+    while (lo < hi) {
+        u64 mid = (lo + hi) / 2;
+        if (curly_pairs[mid].open < open_tok_id)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    assert(lo < curly_pairs.size && curly_pairs[lo].open == open_tok_id);
+    return curly_pairs[lo].close;
+}
+
+u32 SourceFile::paren_arg_count(u64 open_tok_id) {
+    // paren_args is sorted by the opening bracket
+    u64 lo = 0, hi = paren_args.size;
+    while (lo < hi) {
+        u64 mid = (lo + hi) / 2;
+        if (paren_args[mid].open < open_tok_id)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    assert(lo < paren_args.size && paren_args[lo].open == open_tok_id);
+    return paren_args[lo].count;
+}
+
+u32 SourceFile::line_of(u64 offset) {
+    // Find the last line that starts at or before offset
+    u64 lo = 0, hi = line_start.size;
+    while (lo < hi) {
+        u64 mid = (lo + hi) / 2;
+        if (line_start[mid] <= offset)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    assert(lo > 0);
+    return lo - 1;
+}
+
 Token SourceFile::pushToken(SmallToken st, LocationInFile loc) {
-    _tokens.push(st);
-    _token_locations.push(loc);
-    return getToken(_tokens.size - 1);
+    _token_types.push(st.type);
+    _token_starts.push((u32)loc.start);
+
+    if (st.name) {
+        _token_payloads.push(_token_names.size);
+        _token_names.push(st.name);
+    } else {
+        _token_payloads.push(NO_TOKEN_PAYLOAD);
+    }
+    return getToken(token_count() - 1);
 }
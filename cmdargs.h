@@ -15,11 +15,46 @@ struct SourceFile {
     // line_start[100] is the character at which the 100th line starts
     arr<u64> line_start;
 
-	arr<SmallToken> _tokens;
-    arr<LocationInFile> _token_locations;
+    // The tokens are stored as a structure of arrays, so looking at
+    // the token types (when skimming for ex.) only touches one byte per token.
+    // Offsets are 32-bit, add_source refuses files that don't fit that, so token IDs fit too.
+    // _token_payloads[i] is the index of the token's text in _token_names,
+    // only identifiers and string literals have one.
+    // Where a token ends is only needed for locations, token_end finds it from the start
+	arr<TokenType>   _token_types;
+    arr<u32>         _token_starts;
+    arr<u32>         _token_payloads;
+    arr<const char*> _token_names;
+
+    // Every '{' token and its matching '}', in the order they appear in the file.
+    // The parser uses those to skim over function bodies
+    struct CurlyPair {
+        u32 open;
+        u32 close;
+    };
+    arr<CurlyPair> curly_pairs;
+
+    // Every '(' token and the number of comma separated things directly inside it,
+    // in the order they appear. The parser sizes a call's argument array with those
+    struct ParenArgs {
+        u32 open;
+        u32 count;
+    };
+    arr<ParenArgs> paren_args;
 
     Token pushToken(SmallToken st, LocationInFile loc);
     Token getToken(u64 tok_id);
+    SmallToken getSmallToken(u64 tok_id);
+    inline u64 token_count() { return _token_types.size; }
+
+    // Scans the token's text again, the same way tokenize did (in parser.cpp)
+    u64 token_end(u64 tok_id);
+    u64 matching_curly(u64 open_tok_id);
+    u32 paren_arg_count(u64 open_tok_id);
+
+    // 0-based line and column of a character offset, binary searched in line_start
+    u32 line_of(u64 offset);
+    inline u64 column_of(u64 offset) { return offset - line_start[line_of(offset)]; }
 };
 
 enum OutputType {
@@ -27,6 +62,11 @@ enum OutputType {
     OUTPUT_LINKED_EXECUTABLE
 };
 
+enum DiagnosticsFormat {
+    DIAGNOSTICS_TEXT,
+    DIAGNOSTICS_JSON,
+};
+
 enum Target {
     TARGET_WINDOWS,
     TARGET_UNIX,
@@ -36,7 +76,11 @@ extern arr<SourceFile> sources;
 extern OutputType output_type;
 extern const char* output_file;
 extern Target target;
-extern bool print_llvm, print_tir, print_ast, exec_main, debug_jobs;
+extern DiagnosticsFormat diagnostics_format;
+// run_backend is set when LLVM output is asked for, with -o or -l
+extern bool print_llvm, print_tir, print_ast, exec_main, debug_jobs, skim_bodies, batch_errors, demand_driven, run_backend, print_timings, tir_stats, profile_cte;
+// --profile-cte=<file> also writes the profile's folded stacks there
+extern const char* profile_cte_folded;
 
 bool add_source(std::wstring& filename, u32* out);
 bool parse_args(int argc, const char** argv);
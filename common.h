@@ -103,6 +103,7 @@ enum TokenType : u8 {
     KW_WHILE,
     KW_FOR,
     KW_TYPEOF,
+    KW_EXPORT,
 
 	TOK_ERROR,
 
@@ -138,15 +139,13 @@ struct Location {
 };
 
 
-struct NumberData;
-
+// SmallTokens are not stored, they're a view of a token in SourceFile's token arrays
 struct SmallToken {
     enum TokenType type;
-    
-    union {
-        const char* name;
-        NumberData* number_data;
-    };
+
+    // The text of identifiers and string literals, 
+    // numbers are decoded from the source by the parser
+    const char* name;
 };
 
 struct Token : SmallToken {
@@ -197,7 +196,12 @@ enum AST_NodeType : u8 {
 
 struct AST_Node {
 	AST_NodeType nodetype;
-    inline AST_Node(AST_NodeType nt) : nodetype(nt) {}
+
+    // Index into AST_GlobalContext::node_locations, 0 if the node doesn't have a location.
+    // This fits in the padding after nodetype, so it doesn't make the nodes any bigger
+    u32 location_id;
+
+    inline AST_Node(AST_NodeType nt) : nodetype(nt), location_id(0) {}
 };
 
 #endif // guard
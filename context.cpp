@@ -8,7 +8,9 @@ AST_Context::AST_Context(AST_Context* parent)
     : AST_Node(AST_BLOCK),
       parent(parent), 
       global(parent ? parent->global : *(AST_GlobalContext*)this), 
-      fn(parent ? parent->fn : nullptr) 
+      fn(parent ? parent->fn : nullptr),
+      children(0),
+      subscribers(0)
 { 
     if (parent)
         parent->children.push(this);
@@ -39,6 +41,14 @@ u32 map_equals(DeclarationKey &lhs, DeclarationKey &rhs) {
     return true;
 }
 
+u32 map_hash(OverloadKey key) {
+    return map_hash(key.name) ^ key.arity;
+}
+
+bool map_equals(OverloadKey lhs, OverloadKey rhs) {
+    return lhs.arity == rhs.arity && !strcmp(lhs.name, rhs.name);
+}
+
 bool AST_Context::declare(DeclarationKey key, AST_Node* value, bool sendmsg) {
     // Throw an error if another value with the same name has been declared
     AST_Node* prev_decl;
@@ -53,6 +63,12 @@ bool AST_Context::declare(DeclarationKey key, AST_Node* value, bool sendmsg) {
 
     declarations.insert(key, value);
 
+    if (value IS AST_FN && key.name) {
+        AST_FnType *fntype = ((AST_Fn*)value)->fntype();
+        u32 arity = fntype->is_variadic ? OVERLOAD_VARIADIC : fntype->param_types.size;
+        overloads[{ key.name, arity }].push((AST_Fn*)value);
+    }
+
     if (sendmsg) {
         assert(key.name);
 
@@ -72,79 +88,124 @@ void AST_Context::error(Error err) {
     global.errors.push(err);
 }
 
-struct TypeSizeTuple {
-    AST_Type* t;
-    u64 u;
-};
-
-map<TypeSizeTuple, AST_ArrayType*> array_types;
+void AST_Context::release_statements() {
+    statements.clear();
+    for (AST_Context *child : children)
+        child->release_statements();
+}
 
-bool validate_type(AST_Context& ctx, AST_Type** type);
+u32 map_hash(TypeDescriptor desc) {
+    u32 hash = desc.kind ^ (desc.base << 8) ^ (u32)desc.length ^ desc.is_variadic;
 
-u32 map_hash(TypeSizeTuple tst) {
-    return map_hash(tst.t) ^ (u32)tst.u;
+    if (desc.kind == AST_FN_TYPE) {
+        for (u64 i = 0; i < desc.length; i++) {
+            hash ^= desc.params[i];
+            hash = (hash << 5) | (hash >> 27);
+        }
+    }
+    return hash;
 }
 
-u32 map_equals(TypeSizeTuple lhs, TypeSizeTuple rhs) {
-    return lhs.t == rhs.t && lhs.u == rhs.u;
-}
+bool map_equals(TypeDescriptor lhs, TypeDescriptor rhs) {
+    MUST (lhs.kind == rhs.kind);
+    MUST (lhs.base == rhs.base);
+    MUST (lhs.length == rhs.length);
+    MUST (lhs.is_variadic == rhs.is_variadic);
 
-u32 hash(AST_Type* returntype, bucketed_arr<AST_Type*>& param_types) {
-    u32 hash = map_hash(returntype);
+    if (lhs.kind == AST_FN_TYPE)
+        MUST (!memcmp(lhs.params, rhs.params, sizeof(u32) * lhs.length));
 
-    for (AST_Type* param : param_types) {
-        hash ^= map_hash((void*)param);
-        hash <<= 1;
-    }
+    return true;
+}
 
-    return hash;
+TypeTable::TypeTable() {
+    // No type has ID 0
+    types.push(nullptr);
+
+    // The global context in main.cpp can be constructed before the primitives in typer.cpp are,
+    // primitive_types only holds their addresses so it's already initialized, but their IDs might not be
+    for (AST_PrimitiveType *type : primitive_types)
+        types.push(type);
 }
 
-u32 map_hash(AST_FnType* fntype) {
-    return hash(fntype->returntype, fntype->param_types);
-};
+u32 TypeTable::id_of(AST_Type *type) {
+    assert(type->nodetype & AST_TYPE_BIT);
 
-bool map_equals(AST_FnType *lhs, AST_FnType *rhs) {
-    MUST (lhs->returntype == rhs->returntype);
-    MUST (lhs->param_types.size == rhs->param_types.size);
-    MUST (lhs->is_variadic == rhs->is_variadic);
+    if (!type->type_id) {
+        assert(type->nodetype != AST_PRIMITIVE_TYPE);
+        type->type_id = types.size;
+        types.push(type);
+    }
+    assert(types[type->type_id] == type);
+    return type->type_id;
+}
 
-    for (u32 i = 0; i < lhs->param_types.size; i++)
-        MUST (lhs->param_types[i] == rhs->param_types[i]);
+AST_Type *TypeTable::find(TypeDescriptor desc) {
+    AST_Type *type;
+    return interned.find(desc, &type) ? type : nullptr;
+}
 
-    return true;
+void TypeTable::insert(TypeDescriptor desc, AST_Type *type) {
+    assert(!type->type_id);
+    id_of(type);
+    interned.insert(desc, type);
 }
 
+bool validate_type(AST_Context& ctx, AST_Type** type);
+
 // TODO RESOLUTION we should check if it's a AST_UnresolvedId
 AST_PointerType* AST_Context::get_pointer_type(AST_Type* pointed_type) {
-    AST_PointerType* pt;
-    if (!global.pointer_types.find(pointed_type, &pt)) {
+    TypeTable &tt = global.type_table;
+    TypeDescriptor desc = { .kind = AST_POINTER_TYPE, .base = tt.id_of(pointed_type) };
+
+    AST_PointerType* pt = (AST_PointerType*)tt.find(desc);
+    if (!pt) {
         pt = alloc<AST_PointerType>(pointed_type, global.target.pointer_size);
-        global.pointer_types.insert(pointed_type, pt);
+        tt.insert(desc, pt);
     }
     return pt;
 }
 
 AST_ArrayType* AST_Context::get_array_type(AST_Type* base_type, u64 size) {
-    TypeSizeTuple key = { base_type, size };
-    AST_ArrayType* at;
-    if (!array_types.find(key, &at)) {
+    TypeTable &tt = global.type_table;
+    TypeDescriptor desc = { .kind = AST_ARRAY_TYPE, .base = tt.id_of(base_type), .length = size };
+
+    AST_ArrayType* at = (AST_ArrayType*)tt.find(desc);
+    if (!at) {
         at = alloc<AST_ArrayType>(base_type, size);
-        array_types.insert(key, at);
+        tt.insert(desc, at);
     }
     return at;
 }
 
 AST_FnType* AST_Context::make_function_type_unique(AST_FnType* temp_type) {
-    AST_FnType* result;
-    if (global.fn_types_hash.find(temp_type, &result)) {
+    TypeTable &tt = global.type_table;
+
+    // Most lookups find the type, so the parameters are only copied out of the stack on insert
+    small_arr<u32, 8> params;
+    for (AST_Type *param : temp_type->param_types)
+        params.push(tt.id_of(param));
+
+    TypeDescriptor desc = { 
+        .kind = AST_FN_TYPE,
+        .is_variadic = temp_type->is_variadic,
+        .base = tt.id_of(temp_type->returntype),
+        .length = params.size,
+        .params = params.buffer,
+    };
+
+    AST_FnType* result = (AST_FnType*)tt.find(desc);
+    if (result)
         return result;
-    }
-    else {
-        AST_FnType* newtype = alloc<AST_FnType>(std::move(*temp_type));
-        global.fn_types_hash.insert(newtype, newtype);
-        return newtype;
-    }
+
+    // The descriptor that's stored in the table must outlive params
+    u32 *stored_params = (u32*)global.allocator.alloc(sizeof(u32) * params.size, alignof(u32));
+    memcpy(stored_params, params.buffer, sizeof(u32) * params.size);
+    desc.params = stored_params;
+
+    AST_FnType* newtype = alloc<AST_FnType>(std::move(*temp_type));
+    tt.insert(desc, newtype);
+    return newtype;
 }
 
 void AST_Context::decrement_hanging_declarations() {
@@ -163,4 +224,15 @@ void AST_Context::close() {
 }
 
 AST_GlobalContext::AST_GlobalContext() : AST_Context(nullptr) {
+    // location_id 0 means the node doesn't have a location
+    node_locations.push({});
+}
+
+void AST_GlobalContext::set_location(AST_Node *node, Location loc) {
+    if (node->location_id) {
+        node_locations[node->location_id] = loc;
+    } else {
+        node->location_id = node_locations.size;
+        node_locations.push(loc);
+    }
 }
@@ -38,14 +38,57 @@ struct DeclarationKey {
 u32 map_hash(DeclarationKey key);
 u32 map_equals(DeclarationKey &lhs, DeclarationKey &rhs);
 
-u32 map_hash(AST_FnType *fntype);
-bool map_equals(AST_FnType *lhs, AST_FnType *rhs);
+// Functions declared in a scope are also indexed by their name and number of parameters,
+// so when resolving a call we only look at the overloads that can take that many arguments.
+// Variadic functions go under OVERLOAD_VARIADIC, as they can be called with any number
+// of arguments greater than or equal to their parameter count.
+#define OVERLOAD_VARIADIC ((u32)-1)
+
+struct OverloadKey {
+    const char *name;
+    u32 arity;
+};
+
+u32 map_hash(OverloadKey key);
+bool map_equals(OverloadKey lhs, OverloadKey rhs);
 
 struct CompileTarget {
     u64 pointer_size;
     u64 coerce_target_size;
 };
 
+// Pointer, array and function types are hash-consed by their structure,
+// so two types are the same if and only if their pointers are the same.
+// TypeDescriptor is the compact key we intern them by, it refers
+// to the types it's made of by their ID in the TypeTable
+struct TypeDescriptor {
+    AST_NodeType kind;
+    bool is_variadic;
+
+    u32 base;           // the pointed type, the array element type or the return type
+    u64 length;         // the array length or the number of function parameters
+    const u32 *params;  // the function parameters
+};
+
+u32 map_hash(TypeDescriptor desc);
+bool map_equals(TypeDescriptor lhs, TypeDescriptor rhs);
+
+struct TypeTable {
+    map<TypeDescriptor, AST_Type*> interned;
+
+    // types[id] is the type with that ID, side tables keyed by type can be arrays indexed by it.
+    // The ID is stored in the type itself. The primitive types are shared by every 
+    // AST_GlobalContext and have the same fixed IDs in all of them, the rest belong to one context.
+    // Composite types get an ID when they're interned, structs on first use
+    arr<AST_Type*> types;
+
+    TypeTable();
+
+    u32 id_of(AST_Type *type);
+    AST_Type *find(TypeDescriptor desc);
+    void insert(TypeDescriptor desc, AST_Type *type);
+};
+
 struct Namespace {
     map<DeclarationKey, AST_Node*> declarations;
     arr<Namespace*> used;
@@ -55,7 +98,7 @@ struct Namespace {
 
 
 struct AST_Context : AST_Node {
-    map<DeclarationKey, AST_Node*> declarations;
+    small_map<DeclarationKey, AST_Node*> declarations;
     bucketed_arr<AST_Node*> statements;
 
     AST_GlobalContext &global;
@@ -64,6 +107,9 @@ struct AST_Context : AST_Node {
     AST_FnLike* fn; // the function that this context is a part of
     arr<AST_Context*> children;
 
+    // See OverloadKey
+    small_map<OverloadKey, arr<AST_Fn*>> overloads;
+
     AST_Context(AST_Context* parent);
     AST_Context(AST_Context&) = delete;
     AST_Context(AST_Context&&) = delete;
@@ -72,12 +118,19 @@ struct AST_Context : AST_Node {
     bool declare(DeclarationKey key, AST_Node* value, bool sendmsg);
     void error(Error err);
 
+    // Drops the statements of this scope and all its children once they've been lowered.
+    // The nodes themselves live in the AST allocator, only the statement lists are freed
+    void release_statements();
+
     // those will receive message for new declarations & scope closed
     arr<HeapJob*> subscribers;
 
     template <typename T, typename ... Ts>
     T* alloc(Ts &&...args);
 
+    template <typename T>
+    T* alloc_array(u32 count);
+
     // The scope is closed when it's guarenteed that nothing else will be
     // declared inside it. If a scope is closed a ResolveJob waiting for a
     // new declaration inside the scope can stop, because that declaration
@@ -109,6 +162,7 @@ struct AST_Context : AST_Node {
     //       (see make_function_type_unique)
     //
     //    After those passes, the valeus allocated here are no longer relevant and they're released
+    //    (main frees the temp allocator once all the jobs are done)
     //    If something is only needed until before the typing stage, you should allocate it here
     template <typename T, typename ... Ts>
     T* alloc_temp(Ts &&...args);
@@ -161,6 +215,10 @@ struct AST_GlobalContext : AST_Context {
 	arr<Error> errors;
     arr<AST_UnresolvedId*> unresolved;
 
+    // Slots holding AST_UnresolvedIds the parser hasn't tried to resolve yet.
+    // They're flushed by resolve_pending_ids once a function body is parsed
+    arr<AST_UnresolvedId**> pending_ids;
+
     // When a function is parsed we cannot immediately declare it because
     // we don't know its type yet. This is not an issue for vars,
     // because they don't have overloads and are declared immediately
@@ -173,24 +231,30 @@ struct AST_GlobalContext : AST_Context {
     map<const char*, AST_StringLiteral*> literals;
 
     linear_alloc allocator, temp_allocator;
+
+    // Heap jobs live until the end of the compilation, so they're never freed one by one
+    linear_alloc job_allocator;
     struct TIR_Context *tir_context;
 
     CompileTarget target = { 8, 8 };
 
     // there are two ways of storing information about a node's location
-    // - definition_locations[node] tells us where a node is defined.
-    // but that is referenced from a lot of different places in the AST and
-    // we don't have a reference node, so 
-    // - to track locations of references we use a pointer to the reference
-    // the catch is that now that must be const as well
-    map<AST_Node*,  Location> definition_locations;
+    // - node_locations[node->location_id] is where the node itself is in the source.
+    // Locations are only read when reporting errors, so they're kept in
+    // a dense side table instead of inside the nodes or a hash map.
+    // - reference_locations[&ptr] is where a reference is, keyed by the pointer in the AST
+    // that refers to the node. Identifiers need it, once they're resolved that pointer
+    // is replaced with the declaration, which is referenced from a lot of places
+    // and has its own location. Types the typer substitutes in place get one too
+    arr<Location> node_locations;
     map<AST_Node**, Location> reference_locations;
 
-    // function/pointer types must be unique
+    void set_location(AST_Node *node, Location loc);
+
+    // function/pointer/array types must be unique
     // AST_Type*s MUST be comparable by checking their pointers with ==,
-    // so we need those maps to make sure we don't create the same composite type twice.
-    map<AST_FnType*, AST_FnType*> fn_types_hash; // TODO DS - thish should be a hashset
-    map<AST_Type*, AST_PointerType*> pointer_types;
+    // so we intern them here to make sure we don't create the same composite type twice.
+    TypeTable type_table;
 
     arr<HeapJob*> ready_jobs;
     map<u64, HeapJob*> jobs_by_id;
@@ -208,7 +272,8 @@ struct AST_GlobalContext : AST_Context {
 struct HeapJob {
     inline Job *job() { return (Job*)_the_job; };
     u32 dependencies_left = 0;
-    arr<u64> dependent_jobs;
+    // Almost every job has a single job waiting for it
+    small_arr<u64, 2> dependent_jobs;
 
     void add_dependency(HeapJob* dependency, bool fail_parent);
 
@@ -242,7 +307,8 @@ struct Job {
         HeapJob *heap_job;
 
         if (!global.jobs_by_id.find(id, &heap_job)) {
-            heap_job = (HeapJob*)malloc(sizeof(HeapJob) + sizeof(JobT));
+            static_assert(alignof(JobT) <= alignof(HeapJob), "the job is placed right after its HeapJob header");
+            heap_job = (HeapJob*)global.job_allocator.alloc(sizeof(HeapJob) + sizeof(JobT), alignof(HeapJob));
             new (heap_job) HeapJob();
             new (heap_job->job()) (JobT) (std::move(*(JobT*)this));
             global.jobs_by_id[id] = heap_job;
@@ -263,7 +329,7 @@ struct Job {
     HeapJob *run_stackjob() {
         if (run(nullptr)) {
             if (debug_jobs)
-                wcout << dim << "Finished stackjob " << resetstyle << get_name() << "\n";
+                wout << dim << "Finished stackjob " << resetstyle << get_name() << std::endl;
             if (on_complete) {
                 on_complete(this, nullptr);
             }
@@ -288,11 +354,11 @@ struct Job {
             if (debug_jobs) {
                 HeapJob *hj;
                 if (global.jobs_by_id.find(child.id, &hj)) {
-                    wcout << red << "Stackjob finished but was already heapified:" << resetstyle << child.get_name() << "\n";
-                    wcout.flush();
+                    wout << red << "Stackjob finished but was already heapified:" << resetstyle << child.get_name() << "\n";
+                    wout.flush();
                     assert(!"ASDFASASFAFSFA");
                 }
-                wcout << dim << "Finished stackjob " << resetstyle << child.get_name() << "\n";
+                wout << dim << "Finished stackjob " << resetstyle << child.get_name() << std::endl;
             }
 
             if (child.on_complete) {
@@ -331,15 +397,20 @@ struct Job {
 
 template <typename T, typename ... Ts>
 T* AST_Context::alloc(Ts &&...args) {
-    T* buf = (T*)global.allocator.alloc(sizeof(T));
-    new (buf) T (args...);
+    T* buf = (T*)global.allocator.alloc(sizeof(T), alignof(T));
+    new (buf) T (std::forward<Ts>(args)...);
     return buf;
 }
 
+template <typename T>
+T* AST_Context::alloc_array(u32 count) {
+    return (T*)global.allocator.alloc(sizeof(T) * count, alignof(T));
+}
+
 template <typename T, typename ... Ts>
 T* AST_Context::alloc_temp(Ts &&...args) {
-    T* buf = (T*)global.temp_allocator.alloc(sizeof(T));
-    new (buf) T (args...);
+    T* buf = (T*)global.temp_allocator.alloc(sizeof(T), alignof(T));
+    new (buf) T (std::forward<Ts>(args)...);
     return buf;
 }
 
@@ -356,6 +427,10 @@ Location location_of(AST_Context& ctx, AST_Node** node);
 bool parse_all(AST_Context& global);
 bool parse_source_file(AST_Context& global, SourceFile& sf);
 
+// Parse the body of a function that parse_fn has skimmed over, 
+// does nothing if the body has already been parsed
+bool parse_fn_body(AST_Fn *fn);
+
 #define WAIT(job, mytype, jobtype, ...)              \
 {                                                \
     HeapJob *heap_job = job.run_stackjob<jobtype>(); \
@@ -370,4 +445,24 @@ bool parse_source_file(AST_Context& global, SourceFile& sf);
     }                                            \
 }
 
+// Woken up jobs run again from the top of run(). To not redo the work they've already done,
+// jobs keep a progress counter (an index into a list of children, or a stage).
+// This is WAIT, but if the job has to wait, the counter is bumped before the job is moved to the heap,
+// so once the child job is done the job picks up right after it instead of running the child again.
+// The child's result must be stored in the AST, as the child job isn't around when the job is resumed
+#define WAIT_AND_RESUME(job, progress, mytype, jobtype, ...) \
+{                                                \
+    HeapJob *heap_job = job.run_stackjob<jobtype>(); \
+    if (heap_job) {                              \
+        progress++;                              \
+        HeapJob *this_heap_job = heapify<mytype>();  \
+        this_heap_job->add_dependency(heap_job, true); \
+        __VA_ARGS__                              \
+        return false;                            \
+    } else if (job.flags & JOB_ERROR) {          \
+        set_error_flag();                        \
+        return false;                            \
+    }                                            \
+}
+
 #endif // guard
@@ -1,6 +1,10 @@
 #include "common.h"
 #include "ds.h"
 
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
 // https://github.com/explosion/murmurhash/blob/master/murmurhash/MurmurHash2.cpp
 u32 map_hash (const char* data) {
   const u32 m = 0x5bd1e995;
@@ -64,27 +68,66 @@ bool map_equals(u64 lhs, u64 rhs) {
     return lhs == rhs;
 }
 
-char* linear_alloc::alloc(u64 bytes) {
-    bytes = (bytes / 8) * 8 + 8;
+static char* alloc_block(u64 size) {
+#ifdef MADV_HUGEPAGE
+    if (size >= linear_alloc::HUGE_PAGE_SIZE) {
+        void* block;
+        if (!posix_memalign(&block, linear_alloc::HUGE_PAGE_SIZE, size)) {
+            // Only a hint, if it fails we just get regular pages
+            madvise(block, size, MADV_HUGEPAGE);
+            return (char*)block;
+        }
+    }
+#endif
+    char* block = (char*)malloc(size);
+    assert(block);
+    return block;
+}
+
+void linear_alloc::grow(u64 min_size) {
+    // Allocations that don't fit in a regular block get a block of their own
+    u64 size = next_block_size;
+    while (size < min_size)
+        size *= 2;
+
+    if (next_block_size < MAX_BLOCK_SIZE)
+        next_block_size *= 2;
+
+    current = alloc_block(size);
+    remaining = size;
+    blocks.push(current);
+}
 
-    if (remaining < bytes) {
-        remaining = 64 * 1024 * 1024;
-        assert(bytes < remaining);
-        current = (char*)malloc(remaining);
-        blocks.push(current);
-        assert(current);
+char* linear_alloc::alloc(u64 bytes, u64 alignment) {
+    assert(alignment && !(alignment & (alignment - 1)));
+
+    u64 padding = -(uintptr_t)current & (alignment - 1);
+
+    if (remaining < bytes + padding) {
+        grow(bytes + alignment);
+        padding = -(uintptr_t)current & (alignment - 1);
     }
 
-    // TODO ALIGNMENT
-    char* r = current;
+    char* r = current + padding;
 
-    current += bytes;
-    remaining -= bytes;
+    current += bytes + padding;
+    remaining -= bytes + padding;
 
     return r;
 }
 
+void linear_alloc::rewind(Savepoint sp) {
+    assert(sp.blocks_count <= blocks.size);
+
+    for (u32 i = sp.blocks_count; i < blocks.size; i++)
+        free(blocks[i]);
+    blocks.size = sp.blocks_count;
+
+    current = sp.current;
+    remaining = sp.remaining;
+}
+
 void linear_alloc::free_all() {
-    for (char* b : blocks)
-        free(b);
+    rewind({ 0, nullptr, 0 });
+    next_block_size = MIN_BLOCK_SIZE;
 }
@@ -3,6 +3,8 @@
 
 #include "common.h"
 #include <initializer_list>
+#include <type_traits>
+#include <utility>
 
 extern bool map_equals(const char* lhs, const char* rhs);
 extern u32 map_hash(const char* key);
@@ -191,6 +193,107 @@ struct map {
 };
 
 
+// A map that keeps its first N entries inline and only allocates a real
+// hash table once it grows past that. Most scopes declare a handful of
+// things or nothing at all, so a linear scan beats hashing and they never touch the heap.
+template <typename K, typename V, u32 N = 4>
+struct small_map {
+    typedef typename map<K, V>::kvp kvp;
+
+    alignas(kvp) char inline_storage[sizeof(kvp) * N];
+    u32 inline_size;
+    map<K, V>* large;
+
+    small_map() : inline_size(0), large(nullptr) {}
+
+    ~small_map() {
+        if (large) {
+            delete large;
+        } else {
+            for (u32 i = 0; i < inline_size; i++)
+                inline_entries()[i].~kvp();
+        }
+    }
+
+    small_map(small_map& other) = delete;
+    small_map& operator= (const small_map& other) = delete;
+
+    kvp* inline_entries() { return (kvp*)inline_storage; }
+
+    V* find2(K key) {
+        if (large)
+            return large->find2(key);
+
+        for (u32 i = 0; i < inline_size; i++)
+            if (map_equals(inline_entries()[i].key, key))
+                return &inline_entries()[i].value;
+        return nullptr;
+    }
+
+    // Same semantics as map::find
+    bool find(K key, V* out) {
+        V* v = find2(key);
+        if (!v)
+            return false;
+        *out = *v;
+        return true;
+    }
+
+    bool insert(K key, V value) {
+        if (large)
+            return large->insert(key, std::move(value));
+
+        if (find2(key))
+            return false;
+
+        if (inline_size == N) {
+            // Past the threshold, move everything to a proper hash table
+            large = new map<K, V>(N * 4);
+            for (u32 i = 0; i < inline_size; i++) {
+                kvp& e = inline_entries()[i];
+                large->insert(e.key, std::move(e.value));
+                e.~kvp();
+            }
+            return large->insert(key, std::move(value));
+        }
+
+        new (&inline_entries()[inline_size++]) kvp { key, std::move(value) };
+        return true;
+    }
+
+    V& operator[](K key) {
+        V* v = find2(key);
+        if (v)
+            return *v;
+        insert(key, {});
+        return *find2(key);
+    }
+
+    struct iterator {
+        small_map* m;
+        u32 i;
+        typename map<K, V>::iterator large_it;
+
+        iterator& operator++() {
+            if (m->large) ++large_it;
+            else          i++;
+            return *this;
+        }
+        kvp& operator*() const { return m->large ? *large_it : m->inline_entries()[i]; }
+        bool operator==(const iterator& other) { return m == other.m && i == other.i && large_it == other.large_it; }
+        bool operator!=(const iterator& other) { return !(*this == other); }
+    };
+
+    iterator begin() {
+        if (large) return { this, 0, large->begin() };
+        return { this, 0, {} };
+    }
+    iterator end() {
+        if (large) return { this, 0, large->end() };
+        return { this, inline_size, {} };
+    }
+};
+
 template <typename T>
 struct arr_ref {
     T* buffer;
@@ -210,8 +313,10 @@ struct arr {
     u32 size;
     u32 capacity;
 
-    arr(u32 capacity = 8) 
-        : capacity(capacity), size(0), buffer((T*)malloc(sizeof(T) * capacity)) { }
+    // An arr with capacity 0 doesn't allocate until the first push.
+    // Most arrs stay empty, so that's the default
+    arr(u32 capacity = 0) 
+        : capacity(capacity), size(0), buffer(capacity ? (T*)malloc(sizeof(T) * capacity) : nullptr) { }
 
     arr(std::initializer_list<T> init) : arr((u32)init.size()) {
         u32 i = 0;
@@ -226,11 +331,14 @@ struct arr {
         copy(other); 
     }
 
+    // The moved-from arr is left empty, not just without a buffer
     arr(arr&& other) {
         buffer = other.buffer;
         size = other.size;
         capacity = other.capacity;
         other.buffer = nullptr;
+        other.size = 0;
+        other.capacity = 0;
     }
 
     ~arr() { 
@@ -250,13 +358,15 @@ struct arr {
         size = other.size;
         capacity = other.capacity;
         other.buffer = nullptr;
+        other.size = 0;
+        other.capacity = 0;
         return *this;
     }
 
     void copy(const arr& other) {
         size = other.size;
         capacity = other.capacity;
-        buffer = (T*)malloc(sizeof(T) * capacity);
+        buffer = capacity ? (T*)malloc(sizeof(T) * capacity) : nullptr;
 
         for (u32 i = 0; i < size; i++)
             new (&buffer[i]) T (other.buffer[i]);
@@ -264,6 +374,13 @@ struct arr {
 
     void realloc(u32 new_capacity) {
         capacity = new_capacity;
+
+        // Types that can be memcpy'd can be moved by the allocator, which can often grow the block in place
+        if (std::is_trivially_copyable<T>::value) {
+            buffer = (T*)::realloc(buffer, sizeof(T) * capacity);
+            return;
+        }
+
         T* new_buffer = (T*)malloc(sizeof(T) * capacity);
         for (u32 i = 0; i < size; i++)
             new (&new_buffer[i]) T (std::move(buffer[i]));
@@ -277,7 +394,7 @@ struct arr {
         return r;
     }
 
-    T& push_unique(T value) {
+    T& push_unique(const T& value) {
         for (u32 i = 0; i < size; i++) {
             if (buffer[i] == value)
                 return buffer[i];
@@ -285,15 +402,31 @@ struct arr {
         return push(value);
     }
 
-    T& push(T value) {
+    T& push(const T& value) {
         if (size >= capacity) {
-            realloc(capacity * 2);
+            // value may be an element of this arr, so it has to be copied out before the buffer moves
+            T copy(value);
+            realloc(capacity ? capacity * 2 : 8);
+            return *new (&buffer[size++]) T(std::move(copy));
         }
+        return *new (&buffer[size++]) T(value);
+    }
 
-        T* ptr = &buffer[size++];
-        new (ptr) T(value);
+    T& push(T&& value) {
+        if (size >= capacity) {
+            T moved(std::move(value));
+            realloc(capacity ? capacity * 2 : 8);
+            return *new (&buffer[size++]) T(std::move(moved));
+        }
+        return *new (&buffer[size++]) T(std::move(value));
+    }
 
-        return buffer[size - 1];
+    // Constructs the element in place, the arguments must not refer to elements of this arr
+    template <typename ... Ts>
+    T& emplace(Ts &&...args) {
+        if (size >= capacity)
+            realloc(capacity ? capacity * 2 : 8);
+        return *new (&buffer[size++]) T(std::forward<Ts>(args)...);
     }
 
     // Move the last element to tht index-th position,
@@ -326,88 +459,278 @@ struct arr {
     T* end()   { return buffer + size; }
 };
 
+// An arr that keeps up to N elements inline, for the ones that almost never grow
+// past a couple of elements. Those never allocate. Like arr, it doesn't run the destructors of its elements
+template <typename T, u32 N>
+struct small_arr {
+    T* buffer;
+    u32 size;
+    u32 capacity;
+    alignas(T) char inline_storage[sizeof(T) * N];
+
+    small_arr() : buffer((T*)inline_storage), size(0), capacity(N) {}
 
-#define BUCKET_SIZE 16
+    small_arr(std::initializer_list<T> init) : small_arr() {
+        for (const auto& v : init)
+            push(v);
+    }
 
-template<typename T>
-struct bucketed_arr {
-    arr<T*> buckets;
-    u32 last_bucket_size = 0;
-    u32 size;
+    small_arr(const small_arr& other) : small_arr() {
+        for (u32 i = 0; i < other.size; i++)
+            push(other.buffer[i]);
+    }
 
-    bucketed_arr() {
-        size = 0;
-        new_bucket();
+    small_arr(small_arr&& other) : small_arr() {
+        if (other.is_inline()) {
+            for (u32 i = 0; i < other.size; i++)
+                new (&buffer[i]) T (std::move(other.buffer[i]));
+            size = other.size;
+        } else {
+            buffer = other.buffer;
+            size = other.size;
+            capacity = other.capacity;
+            other.buffer = (T*)other.inline_storage;
+            other.capacity = N;
+        }
+        other.size = 0;
     }
 
-    void new_bucket() {
-        T* bucket = (T*)malloc(sizeof(T) * BUCKET_SIZE);
-        buckets.push(bucket);
-        last_bucket_size = 0;
+    ~small_arr() {
+        if (!is_inline())
+            free(buffer);
     }
 
-    T operator[](u32 i) const {
-        u32 bucket = i / BUCKET_SIZE;
-        u32 index = i % BUCKET_SIZE;
+    small_arr& operator= (const small_arr& other) = delete;
+    small_arr& operator= (small_arr&& other) = delete;
 
-        return buckets[bucket][index];
+    inline bool is_inline() const { return buffer == (T*)inline_storage; }
+
+    void realloc(u32 new_capacity) {
+        if (std::is_trivially_copyable<T>::value && !is_inline()) {
+            buffer = (T*)::realloc(buffer, sizeof(T) * new_capacity);
+        } else {
+            T* new_buffer = (T*)malloc(sizeof(T) * new_capacity);
+            for (u32 i = 0; i < size; i++)
+                new (&new_buffer[i]) T (std::move(buffer[i]));
+            if (!is_inline())
+                free(buffer);
+            buffer = new_buffer;
+        }
+        capacity = new_capacity;
     }
 
-    T& operator[](u32 i) {
-        u32 bucket = i / BUCKET_SIZE;
-        u32 index = i % BUCKET_SIZE;
+    T& push_unique(const T& value) {
+        for (u32 i = 0; i < size; i++) {
+            if (buffer[i] == value)
+                return buffer[i];
+        }
+        return push(value);
+    }
 
-        return buckets[bucket][index];
+    T& push(const T& value) {
+        if (size >= capacity) {
+            T copy(value);
+            realloc(capacity * 2);
+            return *new (&buffer[size++]) T(std::move(copy));
+        }
+        return *new (&buffer[size++]) T(value);
     }
 
-    T& push(T value) {
-        if (last_bucket_size >= BUCKET_SIZE)
-            new_bucket();
+    template <typename ... Ts>
+    T& emplace(Ts &&...args) {
+        if (size >= capacity)
+            realloc(capacity * 2);
+        return *new (&buffer[size++]) T(std::forward<Ts>(args)...);
+    }
 
-        T& ref = buckets.last()[last_bucket_size++];
-        ref = value;
-        size ++;
-        return ref;
+    T pop() {
+        assert(size && "trying to pop an empty small_arr");
+        return buffer[--size];
     }
 
-    struct iterator {
-        bucketed_arr* a;
-        u32 bucket, i;
-        
-        iterator& operator++() {
-            i++;
-            if (i == BUCKET_SIZE) {
-                i = 0;
-                bucket++;
-            }
-            return *this;
-        }
+    bool contains(T value) {
+        for (auto& v : *this)
+            if (v == value)
+                return true;
+        return false;
+    }
 
-        T& operator*() const { return a->buckets[bucket][i]; }
-        bool operator==(const iterator& other) { return a == other.a && bucket == other.bucket && i == other.i; }
-        bool operator!=(const iterator& other) { return a != other.a || bucket != other.bucket || i != other.i; }
-    };
+    T  operator[](u32 i) const { return buffer[i]; }
+    T& operator[](u32 i)       { return buffer[i]; }
 
-    iterator begin() { return { .a = this, .bucket = 0,                .i = 0 }; }
-    iterator end()   { return { .a = this, .bucket = buckets.size - 1, .i = last_bucket_size }; }
-};
+    T last() const  { return buffer[size - 1]; }
+    T& last()       { return buffer[size - 1]; }
 
+    T* begin() { return buffer; }
+    T* end()   { return buffer + size; }
+};
 
 
 struct linear_alloc {
+    // Blocks start small and double up to MAX_BLOCK_SIZE, so small compiles
+    // don't reserve memory they never use. Blocks of HUGE_PAGE_SIZE and up are huge page backed
+    static const u64 MIN_BLOCK_SIZE = 64 * 1024;
+    static const u64 MAX_BLOCK_SIZE = 64 * 1024 * 1024;
+    static const u64 HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
     arr<char*> blocks;
     char* current;
     u64 remaining;
+    u64 next_block_size;
+
+    // Rewinding to a savepoint releases everything allocated after it was taken
+    struct Savepoint {
+        u32 blocks_count;
+        char* current;
+        u64 remaining;
+    };
 
-    char* alloc(u64 bytes);
+    char* alloc(u64 bytes, u64 alignment = 8);
     void free_all();
 
-    inline linear_alloc() : blocks(), current(nullptr), remaining(0) {}
+    inline Savepoint savepoint() { return { blocks.size, current, remaining }; }
+    void rewind(Savepoint sp);
+
+    inline linear_alloc() : blocks(), current(nullptr), remaining(0), next_block_size(MIN_BLOCK_SIZE) {}
 
     linear_alloc(linear_alloc& other) = delete;
     linear_alloc(linear_alloc&& other) = delete;
     linear_alloc& operator=(const linear_alloc& other) = delete;
     linear_alloc& operator=(linear_alloc&& other) = delete;
+
+private:
+    void grow(u64 min_size);
+};
+
+// Rewinds the allocator to where it was when the scope was entered
+struct linear_alloc_scope {
+    linear_alloc &allocator;
+    linear_alloc::Savepoint sp;
+
+    inline linear_alloc_scope(linear_alloc &allocator) : allocator(allocator), sp(allocator.savepoint()) {}
+    inline ~linear_alloc_scope() { allocator.rewind(sp); }
+
+    linear_alloc_scope(const linear_alloc_scope& other) = delete;
+    linear_alloc_scope& operator=(const linear_alloc_scope& other) = delete;
+};
+
+
+// Index of the highest set bit, x must not be 0
+inline u32 highest_bit(u32 x) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse(&index, x);
+    return index;
+#else
+    return 31 - __builtin_clz(x);
+#endif
+}
+
+// A segmented array - elements never move once they're pushed, so pointers to them stay valid.
+//
+// The first INLINE elements live in the struct itself, so short parameter lists and small scopes
+// never allocate. After that every bucket is as big as everything before it:
+// element i >= INLINE is in the bucket that starts at the highest power of two <= i
+//
+// Buckets come from the allocator if there is one, otherwise from malloc.
+// Like arr, it doesn't run the destructors of its elements
+template <typename T, u32 INLINE = 4>
+struct bucketed_arr {
+    static_assert(INLINE && !(INLINE & (INLINE - 1)), "INLINE must be a power of two");
+
+    alignas(T) char inline_storage[sizeof(T) * INLINE];
+
+    // buckets[k] holds INLINE << k elements
+    arr<T*> buckets;
+    u32 size = 0;
+    linear_alloc *allocator;
+
+    bucketed_arr(linear_alloc *allocator = nullptr) : allocator(allocator) {}
+
+    // The inline elements move with the struct, the buckets don't
+    bucketed_arr(bucketed_arr&& other) 
+        : buckets(std::move(other.buckets)), size(other.size), allocator(other.allocator)
+    {
+        u32 inline_size = size < INLINE ? size : INLINE;
+        for (u32 i = 0; i < inline_size; i++)
+            new (&((T*)inline_storage)[i]) T (std::move(((T*)other.inline_storage)[i]));
+        other.size = 0;
+    }
+
+    bucketed_arr(const bucketed_arr& other) = delete;
+    bucketed_arr& operator= (const bucketed_arr& other) = delete;
+
+    ~bucketed_arr() {
+        free_buckets();
+    }
+
+    inline T* slot(u32 i) {
+        if (i < INLINE)
+            return &((T*)inline_storage)[i];
+
+        u32 bit = highest_bit(i);
+        return &buckets[bit - highest_bit(INLINE)][i - (1u << bit)];
+    }
+
+    T  operator[](u32 i) const { return *((bucketed_arr*)this)->slot(i); }
+    T& operator[](u32 i)       { return *slot(i); }
+
+    T& push(const T& value) {
+        return *new (slot_for_push()) T(value);
+    }
+
+    T& push(T&& value) {
+        return *new (slot_for_push()) T(std::move(value));
+    }
+
+    // Forgets all elements and releases the buckets
+    void clear() {
+        free_buckets();
+        buckets = arr<T*>(0);
+        size = 0;
+    }
+
+    struct iterator {
+        bucketed_arr* a;
+        u32 i;
+        T *ptr, *bucket_end;
+
+        iterator& operator++() {
+            i++;
+            if (++ptr == bucket_end && i < a->size) {
+                // i is a power of two here, the start of the next bucket
+                ptr = a->slot(i);
+                bucket_end = ptr + i;
+            }
+            return *this;
+        }
+
+        T& operator*() const { return *ptr; }
+        bool operator==(const iterator& other) { return a == other.a && i == other.i; }
+        bool operator!=(const iterator& other) { return a != other.a || i != other.i; }
+    };
+
+    iterator begin() { return { this, 0, (T*)inline_storage, (T*)inline_storage + INLINE }; }
+    iterator end()   { return { this, size, nullptr, nullptr }; }
+
+private:
+    T* slot_for_push() {
+        // Every power of two past the inline elements starts a new bucket
+        if (size >= INLINE && !(size & (size - 1))) {
+            T *bucket = allocator 
+                ? (T*)allocator->alloc(sizeof(T) * size, alignof(T)) 
+                : (T*)malloc(sizeof(T) * size);
+            buckets.push(bucket);
+        }
+        return slot(size++);
+    }
+
+    void free_buckets() {
+        if (!allocator) {
+            for (T *bucket : buckets)
+                free(bucket);
+        }
+    }
 };
 
 
@@ -3,26 +3,42 @@
 #include "ast.h"
 #include <algorithm>
 #include <iomanip>
+#include <sstream>
 
 
 enum VirtualTokens {
     VIRT_MISSING_TYPE_SPECIFIER = 2,
 };
 
-void print_line(AST_Context &global, SourceFile& sf, i64 line, arr<Location>& red_tokens) {
-    if (line < 0 || line > sf.line_start.size)
+// Where a highlighted token starts or ends. The events of a file are sorted by offset,
+// so printing a line only has to look at the events that fall inside it
+struct HighlightEvent {
+    u64 offset;
+    bool is_start;
+
+    inline bool operator< (const HighlightEvent& other) const {
+        // Close the previous token before opening the next one at the same offset
+        if (offset != other.offset)
+            return offset < other.offset;
+        return !is_start && other.is_start;
+    }
+};
+
+void print_line(SourceFile& sf, i64 line, arr<HighlightEvent>& events) {
+    if (line < 0 || line >= sf.line_start.size)
         return;
 
     wcout << dim << std::setw(6) << line + 1 << L" │ " << resetstyle;
 
     u64 line_start = sf.line_start[(u32)line];
 
-    for (u64 i = line_start; i < sf.length && sf.buffer[i] != '\n'; i++) {
+    HighlightEvent *ev = std::lower_bound(events.begin(), events.end(), HighlightEvent { line_start, false });
 
-        for (Location& loc : red_tokens) {
-            if (loc.file_id == sf.id && loc.loc.start == i)
+    for (u64 i = line_start; i < sf.length && sf.buffer[i] != '\n'; i++) {
+        for (; ev != events.end() && ev->offset == i; ev++) {
+            if (ev->is_start)
                 wcout << red;
-            if (loc.file_id ==sf.id && loc.loc.end == i)
+            else
                 wcout << resetstyle;
         }
 
@@ -31,14 +47,6 @@ void print_line(AST_Context &global, SourceFile& sf, i64 line, arr<Location>& re
     wcout << resetstyle << '\n';
 }
 
-int get_line(SourceFile& sf, LocationInFile loc) {
-    for (u32 i = 0; i < sf.line_start.size; i++) {
-        if (loc.start < sf.line_start[i])
-            return i - 1;
-    }
-    return sf.line_start.size - 1;
-}
-
 struct ERR_OfType {
     AST_Value* val;
 };
@@ -72,18 +80,11 @@ ERR_OfType oftype(AST_Node* node) {
     return ERR_OfType { (AST_Value*)node };
 }
 
-void print_code_segment(AST_Context& global, arr<Token>* tokens, arr<AST_Node*>* nodes, arr<AST_Node**>* node_ptrs) {
-    // Group the tokens by file
-    map<SourceFile*, arr<Location>> grouped;
-
+// The locations that get highlighted when the error is printed
+void collect_spans(AST_Context& global, arr<Token>* tokens, arr<AST_Node*>* nodes, arr<AST_Node**>* node_ptrs, arr<Location>& spans) {
     if (tokens) {
-        for (Token& t : *tokens) {
-            SourceFile* sf = &sources[t.file_id];
-            if (!grouped.find(sf, nullptr)) {
-                grouped.insert(sf, arr<Location>());
-            }
-            grouped[sf].push({ .file_id = sf->id, .loc = t.loc });
-        }
+        for (Token& t : *tokens)
+            spans.push({ .file_id = t.file_id, .loc = t.loc });
     }
 
     if (nodes) {
@@ -91,13 +92,7 @@ void print_code_segment(AST_Context& global, arr<Token>* tokens, arr<AST_Node*>*
             Location loc = location_of(global, &n);
             assert((loc.file_id || loc.loc.end || loc.loc.end) 
                     && "The AST Node doesn't have a defined location");
-
-            SourceFile* sf = &sources[loc.file_id];
-
-            if (!grouped.find2(sf)) {
-                grouped.insert(sf, arr<Location>());
-            }
-            grouped[sf].push(loc);
+            spans.push(loc);
         }
     }
 
@@ -106,24 +101,36 @@ void print_code_segment(AST_Context& global, arr<Token>* tokens, arr<AST_Node*>*
             Location loc = location_of(global, n);
             assert((loc.file_id || loc.loc.end || loc.loc.end) 
                     && "The AST Node doesn't have a defined location");
+            spans.push(loc);
+        }
+    }
+}
 
-            SourceFile* sf = &sources[loc.file_id];
+void print_code_segment(arr<Location>& spans) {
+    // Group the tokens by file
+    map<SourceFile*, arr<Location>> grouped;
 
-            if (!grouped.find(sf, nullptr)) {
-                grouped.insert(sf, arr<Location>());
-            }
-            grouped[sf].push(loc);
+    for (Location& loc : spans) {
+        SourceFile* sf = &sources[loc.file_id];
+        if (!grouped.find2(sf)) {
+            grouped.insert(sf, arr<Location>());
         }
+        grouped[sf].push(loc);
     }
 
     for (auto& kvp : grouped) {
         std::wcout << kvp.key->filename << ":\n";
         arr<Location>& toks = kvp.value;
 
+        arr<HighlightEvent> events;
         arr<u64> lines;
-        for (Location& t : toks)
-            lines.push_unique(get_line(sources[t.file_id], t.loc));
+        for (Location& t : toks) {
+            events.push({ t.loc.start, true });
+            events.push({ t.loc.end, false });
+            lines.push_unique(kvp.key->line_of(t.loc.start));
+        }
 
+        std::sort(events.begin(), events.end());
         std::sort(lines.begin(), lines.end());
 
         u64 last = 0;
@@ -141,43 +148,42 @@ void print_code_segment(AST_Context& global, arr<Token>* tokens, arr<AST_Node*>*
             }
 
             for (u64 i = start; i < end; i++)
-                print_line(global, *kvp.key, (i64)i, toks);
+                print_line(*kvp.key, (i64)i, events);
             last = end;
         }
     }
 }
 
 
-void th(u64 n) {
+void th(std::wostream& o, u64 n) {
     static const char* first_10[10] = {
          "zeroth", "first", "second", "third", "fourth", 
          "fifth", "sixth", "seventh", "eighth", "ninth", 
     };
 
     if (n < 10) {
-        wcout << first_10[n];
+        o << first_10[n];
         return;
     } 
     else {
-        wcout << n;
+        o << n;
 
         switch (n % 10) {
-            case 1:  wcout << "st"; break;
-            case 2:  wcout << "nd"; break;
-            case 3:  wcout << "rd"; break;
-            default: wcout << "th"; break;
+            case 1:  o << "st"; break;
+            case 2:  o << "nd"; break;
+            case 3:  o << "rd"; break;
+            default: o << "th"; break;
         }
     }
 }
 
-void print_err(AST_Context &global, Error& err) {
-    wcout << "Fatal: ";
-
+// Writes the error's message to o, and the locations it refers to to spans
+void describe_err(AST_Context &global, Error& err, std::wostream& o, arr<Location>& spans) {
     switch (err.code) {
 
         case ERR_ALREADY_DEFINED: {
-            wcout << red << err.key->name << resetstyle << " is defined multiple times:\n";
-            print_code_segment(global, nullptr, &err.nodes, nullptr);
+            o << red << err.key->name << resetstyle << " is defined multiple times:\n";
+            collect_spans(global, nullptr, &err.nodes, nullptr, spans);
             break;
         }
 
@@ -186,13 +192,13 @@ void print_err(AST_Context &global, Error& err) {
 
             auto arg = err.args[0];
 
-            wcout << "Expected the ";
-            th(arg.arg_index + 1);
-            wcout << " argument to be of type " 
+            o << "Expected the ";
+            th(o, arg.arg_index + 1);
+            o << " argument to be of type " 
                 << red << arg.arg_type << resetstyle 
                 << " but instead got " << oftype(src) << ":\n";
 
-            print_code_segment(global, nullptr, nullptr, &err.node_ptrs);
+            collect_spans(global, nullptr, nullptr, &err.node_ptrs, spans);
 
             break;
             
@@ -203,16 +209,16 @@ void print_err(AST_Context &global, Error& err) {
             AST_Fn     *fn     = (AST_Fn*)fncall->fn;
             AST_FnType *fntype = fn->fntype();
 
-            wcout << fn << " accepts ";
+            o << fn << " accepts ";
             if (fntype->is_variadic)
-                wcout << "at least ";
-            wcout << fntype->param_types.size << " arguments, but was called with ";
+                o << "at least ";
+            o << fntype->param_types.size << " arguments, but was called with ";
             if (fncall->args.size < fntype->param_types.size)
-                wcout << "only ";
-            wcout << fncall->args.size << ":\n";
+                o << "only ";
+            o << fncall->args.size << ":\n";
 
             arr<AST_Node*> nodes = { fncall, fn };
-            print_code_segment(global, nullptr, &nodes, nullptr);
+            collect_spans(global, nullptr, &nodes, nullptr, spans);
             break;
         }
 
@@ -220,11 +226,11 @@ void print_err(AST_Context &global, Error& err) {
             AST_Value* dst = (AST_Value*)*err.node_ptrs[0];
             AST_Value* src = (AST_Value*)*err.node_ptrs[1];
 
-            wcout << "Cannot assign " << oftype(src) << " to " << oftype(dst) << ":\n";
+            o << "Cannot assign " << oftype(src) << " to " << oftype(dst) << ":\n";
 
             arr<AST_Node*> nodes = { err.nodes[0] };
 
-            print_code_segment(global, nullptr, &nodes, nullptr);
+            collect_spans(global, nullptr, &nodes, nullptr, spans);
             break;
         }
 
@@ -235,15 +241,15 @@ void print_err(AST_Context &global, Error& err) {
 
             switch (parent_stmt->nodetype) {
                 case AST_RETURN:
-                    wcout << "Cannot return " << oftype(the_value) << ", the return type is " << dsttype << ":\n";
+                    o << "Cannot return " << oftype(the_value) << ", the return type is " << dsttype << ":\n";
                     break;
                 default:
-                    wcout << "Cannot implicitly cast " << oftype(the_value) << " to " << dsttype << ":\n";
+                    o << "Cannot implicitly cast " << oftype(the_value) << " to " << dsttype << ":\n";
                     break;
             }
 
             arr<AST_Node*> nodes = { parent_stmt };
-            print_code_segment(global, nullptr, &nodes, nullptr);
+            collect_spans(global, nullptr, &nodes, nullptr, spans);
             break;
         }
 
@@ -251,19 +257,19 @@ void print_err(AST_Context &global, Error& err) {
             Token actual = err.tokens[0];
             Token expected = err.tokens[1];
 
-            wcout << "Unexpected "         << red << actual.type   << resetstyle
-                  << " while looking for " << red << expected.type << resetstyle << ":\n";
+            o << "Unexpected "         << red << actual.type   << resetstyle
+              << " while looking for " << red << expected.type << resetstyle << ":\n";
 
             arr<Token> toks = { actual };
-            print_code_segment(global, &toks, nullptr, nullptr);
+            collect_spans(global, &toks, nullptr, nullptr, spans);
             break;
 
             break;
         }
 
         case ERR_NOT_DEFINED: {
-            wcout << red << err.nodes[0] << resetstyle << " is not defined.\n";
-            print_code_segment(global, nullptr, &err.nodes, nullptr);
+            o << red << err.nodes[0] << resetstyle << " is not defined.\n";
+            collect_spans(global, nullptr, &err.nodes, nullptr, spans);
             break;
         }
 
@@ -271,11 +277,11 @@ void print_err(AST_Context &global, Error& err) {
             AST_Return* ret = (AST_Return*)err.nodes[0];
             AST_Fn* fn = (AST_Fn*)err.nodes[1];
             AST_FnType* fntype = fn->fntype();
-            wcout << "Missing return value - expected a value of type " 
+            o << "Missing return value - expected a value of type " 
                 << red << fntype->returntype << resetstyle << ":\n";
 
             arr<AST_Node*> nodes_to_print = { ret };
-            print_code_segment(global, nullptr, &nodes_to_print, nullptr);
+            collect_spans(global, nullptr, &nodes_to_print, nullptr, spans);
             break;
         }
 
@@ -284,28 +290,200 @@ void print_err(AST_Context &global, Error& err) {
             AST_Fn* fn = (AST_Fn*)err.nodes[1];
             AST_FnType* fntype = fn->fntype();
 
-            wcout << "Cannot return " << oftype(ret->value) << ", the function's return type is ";
+            o << "Cannot return " << oftype(ret->value) << ", the function's return type is ";
 
             if (fntype->returntype)
-                wcout << fntype->returntype << ":\n";
+                o << fntype->returntype << ":\n";
             else
-                wcout << "void:\n";
+                o << "void:\n";
 
             arr<AST_Node*> nodes_to_print = { ret };
-            print_code_segment(global, nullptr, &nodes_to_print, nullptr);
+            collect_spans(global, nullptr, &nodes_to_print, nullptr, spans);
             break;
         }
 
         case ERR_BAD_BINARY_OP: {
-            wcout << "Cannot do a binary operation on " << oftype(err.nodes[0]) << " and " << oftype(err.nodes[1]) << ":\n";
-            print_code_segment(global, &err.tokens, &err.nodes, &err.node_ptrs);
+            o << "Cannot do a binary operation on " << oftype(err.nodes[0]) << " and " << oftype(err.nodes[1]) << ":\n";
+            collect_spans(global, &err.tokens, &err.nodes, &err.node_ptrs, spans);
             break;
         }
 
         default: {
-            wcout << "Error " << err.code << std::endl;
-            print_code_segment(global, &err.tokens, &err.nodes, &err.node_ptrs);
+            o << "Error " << err.code << "\n";
+            collect_spans(global, &err.tokens, &err.nodes, &err.node_ptrs, spans);
         }
 
     } 
 }
+
+void print_err(AST_Context &global, Error& err) {
+    // Anything traced so far should come before the error
+    wout.flush();
+
+    arr<Location> spans;
+    wcout << "Fatal: ";
+    describe_err(global, err, wcout, spans);
+    print_code_segment(spans);
+}
+
+// The location an error is sorted by - its first token, or the first of its nodes that has one
+bool primary_location(AST_Context& global, Error& err, Location *out) {
+    if (err.tokens.size) {
+        *out = { .file_id = err.tokens[0].file_id, .loc = err.tokens[0].loc };
+        return true;
+    }
+    for (AST_Node*& n : err.nodes) {
+        if (n && n->location_id) {
+            *out = location_of(global, &n);
+            return true;
+        }
+    }
+    for (AST_Node** n : err.node_ptrs) {
+        if (global.global.reference_locations.find2(n) || (*n)->location_id) {
+            *out = location_of(global, n);
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* error_code_name(ErrorCode code) {
+    switch (code) {
+        case ERR_UNKNOWN:                     return "unknown";
+        case ERR_UNBALANCED_BRACKETS:         return "unbalanced_brackets";
+        case ERR_UNEXPECTED_TOKEN:            return "unexpected_token";
+        case ERR_ALREADY_DEFINED:             return "already_defined";
+        case ERR_NOT_DEFINED:                 return "not_defined";
+        case ERR_INVALID_EXPRESSION:          return "invalid_expression";
+        case ERR_INVALID_NUMBER_FORMAT:       return "invalid_number_format";
+        case ERR_INVALID_ASSIGNMENT:          return "invalid_assignment";
+        case ERR_CANNOT_IMPLICIT_CAST:        return "cannot_implicit_cast";
+        case ERR_BAD_BINARY_OP:               return "bad_binary_op";
+        case ERR_RETURN_TYPE_MISSING:         return "return_type_missing";
+        case ERR_RETURN_TYPE_INVALID:         return "return_type_invalid";
+        case ERR_NOT_AN_LVALUE:               return "not_an_lvalue";
+        case ERR_NO_SUCH_MEMBER:              return "no_such_member";
+        case ERR_INVALID_NUMBER_OF_ARGUMENTS: return "invalid_number_of_arguments";
+        case ERR_BAD_FN_CALL:                 return "bad_fn_call";
+        case ERR_INVALID_TYPE:                return "invalid_type";
+        case ERR_INVALID_DEREFERENCE:         return "invalid_dereference";
+        case ERR_INVALID_CAST:                return "invalid_cast";
+    }
+    return "unknown";
+}
+
+// Appends s as a JSON string. Terminal escape codes are dropped
+void append_json_string(std::string& out, const std::string& s) {
+    out += '"';
+    for (u64 i = 0; i < s.size(); i++) {
+        char c = s[i];
+
+        if (c == '\x1b') {
+            while (i < s.size() && s[i] != 'm') 
+                i++;
+            continue;
+        }
+
+        switch (c) {
+            case '"':  out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\t': out += "\\t"; break;
+            default: {
+                if ((u8)c < 0x20) {
+                    char buf[8];
+                    snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    out += buf;
+                } else {
+                    out += c;
+                }
+            }
+        }
+    }
+    out += '"';
+}
+
+// One error per line:
+// {"severity":"fatal","code":"not_defined","message":"...","spans":[{"file":"a.n","line":1,"column":5,"end_line":1,"end_column":8}]}
+// Lines and columns are 1-based, columns count bytes
+void append_json_err(AST_Context& global, Error& err, std::string& out) {
+    std::wostringstream msg;
+    arr<Location> spans;
+    describe_err(global, err, msg, spans);
+
+    std::string message = wstring_to_utf8(msg.str());
+    while (message.size() && (message.back() == '\n' || message.back() == ':'))
+        message.pop_back();
+
+    out += "{\"severity\":\"fatal\",\"code\":\"";
+    out += error_code_name(err.code);
+    out += "\",\"message\":";
+    append_json_string(out, message);
+    out += ",\"spans\":[";
+
+    for (u32 i = 0; i < spans.size; i++) {
+        SourceFile& sf = sources[spans[i].file_id];
+        LocationInFile loc = spans[i].loc;
+
+        if (i > 0) 
+            out += ',';
+        out += "{\"file\":";
+        append_json_string(out, wstring_to_utf8(sf.filename));
+        out += ",\"line\":"        + std::to_string(sf.line_of(loc.start) + 1);
+        out += ",\"column\":"      + std::to_string(sf.column_of(loc.start) + 1);
+        out += ",\"end_line\":"    + std::to_string(sf.line_of(loc.end) + 1);
+        out += ",\"end_column\":"  + std::to_string(sf.column_of(loc.end) + 1);
+        out += '}';
+    }
+    out += "]}\n";
+}
+
+struct ErrorOrder {
+    u32 file_id;
+    u64 offset;
+    u32 index;
+
+    // Errors without a location are all at {0, 0}, that doesn't make them the same error
+    bool has_location;
+
+    inline bool operator< (const ErrorOrder& other) const {
+        if (file_id != other.file_id) return file_id < other.file_id;
+        if (offset != other.offset)   return offset < other.offset;
+        return index < other.index;
+    }
+};
+
+void print_errors(AST_Context &global, arr<Error>& errors) {
+    arr<ErrorOrder> order(errors.size);
+
+    for (u32 i = 0; i < errors.size; i++) {
+        Location loc = {};
+        bool has_location = primary_location(global, errors[i], &loc);
+        order.push({ loc.file_id, loc.loc.start, i, has_location });
+    }
+
+    std::sort(order.begin(), order.end());
+
+    std::string json;
+
+    for (u32 i = 0; i < order.size; i++) {
+        Error& err = errors[order[i].index];
+
+        // The same error can get reported by more than one job, only print it once
+        if (i > 0) {
+            ErrorOrder& prev = order[i - 1];
+            if (prev.has_location && order[i].has_location
+                    && prev.file_id == order[i].file_id && prev.offset == order[i].offset 
+                    && errors[prev.index].code == err.code)
+                continue;
+        }
+        if (diagnostics_format == DIAGNOSTICS_JSON)
+            append_json_err(global, err, json);
+        else
+            print_err(global, err);
+    }
+
+    // Written in one go, so it doesn't get interleaved with anything else
+    if (json.size())
+        fwrite(json.data(), 1, json.size(), stderr);
+}
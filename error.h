@@ -62,4 +62,9 @@ struct Error {
 struct AST_Context;
 void print_err(AST_Context &AST_GlobalContext, Error& err);
 
+// Prints the errors sorted by file and position, skipping duplicates.
+// With --batch-errors this is the only place errors get printed.
+// With --diagnostics-format=json they're written to stderr as one JSON object per line
+void print_errors(AST_Context &global, arr<Error>& errors);
+
 #endif // guard
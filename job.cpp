@@ -20,8 +20,7 @@ void HeapJob::add_dependency(HeapJob* dependency, bool fail_parent) {
     dependencies_left++;
     dependency->dependent_jobs.push(job()->id);
     if (debug_jobs) {
-        wcout << job()->get_name() << dim << (fail_parent ? " depends on " : " soft-depends on ") << resetstyle << dependency->job()->get_name() << "\n";
-        wcout.flush();
+        wout << job()->get_name() << dim << (fail_parent ? " depends on " : " soft-depends on ") << resetstyle << dependency->job()->get_name() << std::endl;
     }
 
     if (fail_parent) {
@@ -34,8 +33,7 @@ void finish_job(AST_GlobalContext &global, HeapJob *finished_job) {
         finished_job->job()->on_complete(finished_job->job(), nullptr);
     }
     if (debug_jobs) {
-        wcout << dim << "Finished " << resetstyle << finished_job->job()->get_name() << "\n";
-        wcout.flush();
+        wout << dim << "Finished " << resetstyle << finished_job->job()->get_name() << std::endl;
     }
     global.jobs_count--;
     finished_job->job()->flags = (JobFlags)(finished_job->job()->flags | JOB_DONE);
@@ -56,8 +54,7 @@ Job::Job(AST_GlobalContext &global) : global(global) {
 
 void AST_GlobalContext::send_message(arr<HeapJob*> &receivers, Message *msg) {
     if (debug_jobs) {
-        wcout << dim << "Sending message " << resetstyle << msg->msgtype << "\n";
-        wcout.flush();
+        wout << dim << "Sending message " << resetstyle << msg->msgtype << std::endl;
     }
 
     for (u32 i = 0; i < receivers.size; ) {
@@ -87,8 +84,7 @@ void AST_GlobalContext::add_job(HeapJob *job) {
     }
 
     if (debug_jobs) {
-        wcout << dim << "Adding " << resetstyle << job->job()->id << ":" << job->job()->get_name() << "\n";
-        wcout.flush();
+        wout << dim << "Adding " << resetstyle << job->job()->id << ":" << job->job()->get_name() << std::endl;
     }
     ready_jobs.push(job);
 }
@@ -125,9 +121,12 @@ bool AST_GlobalContext::run_jobs() {
 
 
 void Job::error(Error err) {
-    wcout << "Error from job " << get_name() << ":\n";
     global.error(err);
-    print_err(global, err);
+    if (!batch_errors) {
+        wout.flush();
+        wcout << "Error from job " << get_name() << ":\n";
+        print_err(global, err);
+    }
 
     set_error_flag();
 
@@ -1,19 +1,76 @@
 #include "backend/llvm/llvm.h" // include this first
 #include "context.h"
 #include "tir.h"
+#include "tir_profile.h"
 #include "typer.h"
 #include "ast.h"
 #include "cmdargs.h"
 #include "error.h"
 #include "linker.h"
 #include "util.h"
+#include <chrono>
 
 AST_GlobalContext global;
 
 
+// With --timings, how long each phase took is printed to stderr when main returns.
+// The lines look like "parse      12.345 ms", the compile benchmark in bench/ reads them
+struct PhaseTimings {
+    using Clock = std::chrono::steady_clock;
+
+    struct Phase {
+        const char *name;
+        double ms;
+    };
+
+    arr<Phase> phases;
+    Clock::time_point start, phase_start;
+
+    // Time spent in the interpreter, it's part of the jobs phase
+    double exec_ms = 0;
+
+    PhaseTimings() : start(Clock::now()), phase_start(start) {}
+
+    static double ms_between(Clock::time_point from, Clock::time_point to) {
+        return std::chrono::duration<double, std::milli>(to - from).count();
+    }
+
+    void end_phase(const char *name) {
+        Clock::time_point now = Clock::now();
+        phases.push({ name, ms_between(phase_start, now) });
+        phase_start = now;
+    }
+
+    // The -a and -t dumps aren't part of any phase
+    void skip() {
+        phase_start = Clock::now();
+    }
+
+    ~PhaseTimings() {
+        if (!print_timings)
+            return;
+
+        double total = ms_between(start, Clock::now());
+
+        // A trailing newline doesn't start another line
+        u64 lines = 0;
+        for (SourceFile &sf : sources)
+            lines += sf.line_start.size - (sf.length && sf.buffer[sf.length - 1] == '\n');
+
+        fprintf(stderr, "--------- Timings ---------\n");
+        for (Phase &p : phases)
+            fprintf(stderr, "%-10s %10.3f ms\n", p.name, p.ms);
+        if (exec_ms > 0)
+            fprintf(stderr, "%-10s %10.3f ms (in jobs)\n", "exec", exec_ms);
+        fprintf(stderr, "%-10s %10.3f ms\n", "total", total);
+        fprintf(stderr, "%llu lines, %.0f lines/s\n", (unsigned long long)lines, total > 0 ? lines / total * 1000 : 0);
+    }
+};
+
+
 struct MainExecJob : TIR_ExecutionJob {
     void on_complete(void *value) override {
-        wcout << "main returned " << (i64)value << "\n";
+        wout << "main returned " << (i64)value << "\n";
     }
 
     std::wstring get_name() override { return L"MainExecJob"; };
@@ -25,10 +82,12 @@ struct MainExecJob : TIR_ExecutionJob {
 
 int main(int argc, const char** argv) {
     init_utils();
+    PhaseTimings timings;
 
     if (!parse_args(argc, argv)) {
         return 1;
     }
+    timings.end_phase("read");
 
     if (sources.size == 0) {
         printf("no input files\n");
@@ -36,33 +95,55 @@ int main(int argc, const char** argv) {
     }
 
     if (!parse_all(global)) {
-        for (auto& err : global.errors)
-            print_err(global, err);
+        print_errors(global, global.errors);
         exit(1);
     }
+    timings.end_phase("parse");
 
     if (print_ast) {
-        wcout << red << "--------- AST ---------\n" << resetstyle;
+        wout << red << "--------- AST ---------\n" << resetstyle;
         for (const auto& decl : global.declarations) {
-            print(wcout, decl.value, true);
-            wcout << '\n';
+            print(wout, decl.value, true);
+            wout << '\n';
         }
+        wout.flush();
+        timings.skip();
     }
 
     JobGroup _all_tir_compiled_job (global, nullptr);
     HeapJob *all_tir_compiled_job = _all_tir_compiled_job.heapify<JobGroup>();
     global.add_job(all_tir_compiled_job);
     
-    TIR_Context tir_context { .global = global };
+    TIR_Context tir_context { .global = global, .all_compiled = all_tir_compiled_job };
     global.tir_context = &tir_context;
 
+    // Big enough that it shouldn't be on the stack
+    if (tir_stats)
+        tir_context.exec_stats = new TIR_ExecStats();
+    if (profile_cte)
+        tir_context.profile = new TIR_Profile();
+
+    // Functions are lowered to LLVM as soon as their TIR is ready.
+    // The interpreter and the TIR dump still need the TIR after that, otherwise it's freed.
+    // The global initializers run in the interpreter too, even without -e
+    T2L_Context t2l_context(tir_context);
+    if (run_backend) {
+        tir_context.consumer = &t2l_context;
+        t2l_context.release_lowered = !exec_main && !print_tir && global.statements.size == 0;
+    }
+
     for (auto &decl : global.fns_to_declare) {
+        // With --demand-driven this only declares the function. Its body is parsed and typechecked
+        // once it's reachable from main or an exported function, errors in the others aren't reported
         TypeCheckJob _j (decl.scope, decl.fn);
+        _j.signature_only = demand_driven;
         HeapJob *j = _j.heapify<TypeCheckJob>();
         global.add_job(j);
 
-        HeapJob *j2 = tir_context.compile_fn(decl.fn, j);
-        all_tir_compiled_job->add_dependency(j2, true);
+        TIR_Function *tir_fn = tir_context.add_fn(decl.fn, j);
+        tir_fn->body_unchecked = demand_driven;
+        if (!demand_driven || is_exported(decl.fn))
+            tir_context.demand_fn(tir_fn);
     }
 
     for (auto &decl : global.declarations) {
@@ -92,7 +173,27 @@ int main(int argc, const char** argv) {
     }
 
 
-    if (!global.run_jobs()) {
+    bool jobs_ok = global.run_jobs();
+
+    // The interpreter runs during the jobs, whatever it managed to do before a failure is still printed
+    timings.exec_ms = tir_context.exec_ns / 1e6;
+    if (tir_stats)
+        print_tir_stats(tir_context);
+    if (profile_cte) {
+        tir_context.profile->print_report(tir_context.exec_ns);
+        if (profile_cte_folded && !tir_context.profile->write_folded(profile_cte_folded))
+            fprintf(stderr, "couldn't write %s\n", profile_cte_folded);
+    }
+
+    if (!jobs_ok) {
+        if (batch_errors)
+            print_errors(global, global.errors);
+
+        // Whoever reads the JSON only cares about the errors
+        if (diagnostics_format == DIAGNOSTICS_JSON && global.errors.size)
+            return 1;
+
+        wout.flush();
         wcout << red << global.jobs_count << " Jobs didn't complete:\n" << resetstyle;
 
         for (auto &kvp : global.jobs_by_id) {
@@ -113,21 +214,34 @@ int main(int argc, const char** argv) {
         return 1;
     }
 
+    // Every identifier has been resolved and every function type made unique,
+    // so nothing points into the temp allocator anymore
+    global.temp_allocator.free_all();
+    global.unresolved.size = 0;
+
     tir_context.compile_all();
 
+    // When the backend runs, this includes lowering to LLVM, which is interleaved with the typechecking
+    timings.end_phase("jobs");
+
     if (print_tir) {
-        wcout << red << "\n--------- TIR ---------\n" << resetstyle;
-        for (auto& kvp : tir_context.fns)
-            kvp.value->print();
-        wcout.flush();
+        wout << red << "\n--------- TIR ---------\n" << resetstyle;
+        for (auto& kvp : tir_context.fns) {
+            if (kvp.value->compile_job)
+                kvp.value->print(wout);
+        }
+        wout.flush();
+        timings.skip();
     }
 
 
-    return 0;
-    T2L_Context t2l_context(tir_context);
-    t2l_context.compile_all(all_tir_compiled_job);
+    if (!run_backend)
+        return 0;
+
+    t2l_context.finish();
 
     const char* object_filename = t2l_context.output_object();
+    timings.end_phase("backend");
 
     if (output_type == OUTPUT_LINKED_EXECUTABLE) {
         // TODO ENCODING
@@ -144,6 +258,7 @@ int main(int argc, const char** argv) {
         } else if (has_lld) {
             link(lld, object_filename_w, output_filename_w);
         }
+        timings.end_phase("link");
     }
 
 
@@ -3,6 +3,76 @@
 #include "number.h"
 #include <algorithm>
 
+static inline u8 digit_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return 0xFF;
+}
+
+void parse_number(const char *p, NumberData *num_data)  {
+    num_data->base = 10;
+
+    if (p[0] == '0') {
+        switch (p[1]) {
+            case 'b': { num_data->base = 2;  p += 2; break; }
+            case 'o': { num_data->base = 8;  p += 2; break; }
+            case 'x': { num_data->base = 16; p += 2; break; }
+            default: break;
+        }
+    }
+
+    // skip leading zeroes
+    while (*p == '0')
+        p++;
+
+    // Fast path - accumulate the digits into a u64 as long as they fit
+    u64 base = num_data->base;
+    u64 value = 0;
+    const char *digits_start = p;
+
+    for ( ;; p++) {
+        u8 digit = digit_value(*p);
+        if (digit == 0xFF)
+            break;
+
+        if (digit >= base)
+            assert(!"TODO ERROR");
+
+        if (value > (UINT64_MAX - digit) / base)
+            goto Slow;
+        value = value * base + digit;
+    }
+
+    if (*p != '.') {
+        num_data->is_small = true;
+        num_data->small_value = value;
+        return;
+    }
+
+Slow:
+    // The number doesn't fit in a u64 or has a decimal point,
+    // store the digits one by one
+    for (p = digits_start; ; p++) {
+        u8 digit = digit_value(*p);
+
+        if (*p == '.') {
+            if (num_data->decimal_point >= 0)
+                assert(!"TODO ERROR");
+            num_data->decimal_point = num_data->digits.size;
+            continue;
+        } 
+
+        if (digit == 0xFF)
+            break;
+
+        if (digit >= base)
+            assert(!"TODO ERROR");
+
+        num_data->digits.push(digit);
+    }
+}
+
 bool NumberData::is_zero() {
     return (digits.size == 1 && digits[0] == 0) || digits.size == 0;
 }
@@ -69,7 +139,20 @@ std::wostream& operator<< (std::wostream& o, NumberData* number) {
         default: o << "0#" << number->base << "#"; break;
     }
 
-    if (number->base <= 16) {
+    if (number->is_small) {
+        char buf[65];
+        char *p = buf + sizeof(buf) - 1;
+        *p = 0;
+
+        u64 value = number->small_value;
+        do {
+            u8 digit = value % number->base;
+            *--p = digit < 10 ? '0' + digit : 'a' + digit - 10;
+            value /= number->base;
+        } while (value);
+
+        o << p;
+    } else if (number->base <= 16) {
         for (u32 i = 0; i < number->digits.size; i++) {
             u8 digit = number->digits[i];
             if (digit < 10)
@@ -5,9 +5,15 @@
 #include <iostream>
 
 struct NumberData {
-    arr<u8> digits;
     u16     base;
     bool    negative = false;
+
+    // Most literals fit in 64 bits, those are parsed straight into small_value.
+    // Only the ones that don't fit store their digits, one per byte, in the number's base
+    bool    is_small = false;
+    u64     small_value = 0;
+
+    arr<u8> digits = arr<u8>(0);
     // index of the digit before which the decimal point is
     i32     decimal_point = -1;
 
@@ -17,9 +23,20 @@ struct NumberData {
     bool is_zero();
 };
 
-// NOTE - this changes the base of the number to 256
+// Decode the number literal that starts at p
+void parse_number(const char *p, NumberData *num_data);
+
+// NOTE - for big numbers this changes the base of the number to 256
 template <typename T>
 bool number_data_to_unsigned(NumberData *num, T *out) {
+    if (num->is_small) {
+        if (num->negative || num->small_value > (u64)(T)-1)
+            return false;
+
+        *out = (T)num->small_value;
+        return true;
+    }
+
     num->convert_base(256);
 
     if (num->digits.size > sizeof(T) || num->negative)
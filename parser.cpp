@@ -169,8 +169,8 @@ Location location_of(AST_Context& ctx, AST_Node** node) {
     Location loc;
     if (ctx.global.reference_locations.find(node, &loc)) {
         return loc;
-    } else if (ctx.global.definition_locations.find(*node, &loc)) {
-        return loc;
+    } else if ((*node)->location_id) {
+        return ctx.global.node_locations[(*node)->location_id];
     } 
     DIE("The AST_Node doesn't have a location");
 }
@@ -183,56 +183,6 @@ AST_Macro* parse_macro(AST_Context& ctx, TokenReader& r);
 AST_Struct *parse_struct(AST_Context& ctx, TokenReader& r, bool decl);
 
 
-NumberData* parse_number(AST_Context& ctx, char** pos)  {
-    NumberData *num_data = new NumberData();
-    char *&p = *pos;
-    num_data->base = 10;
-
-    if (p[0] == '0') {
-        switch (p[1]) {
-            case 'b': { num_data->base = 2;  p += 2; break; }
-            case 'o': { num_data->base = 8;  p += 2; break; }
-            case 'x': { num_data->base = 16; p += 2; break; }
-            default: break;
-        }
-    }
-
-    // skip leading zeroes
-    while (*p == '0')
-        p++;
-
-    for ( ;; p++) {
-        char digit = *p;
-
-        if (digit >= '0' && digit <= '9') {
-            digit -= '0';
-        } else if (digit >= 'A' && digit <= 'F') {
-            digit -= 'A';
-        } else if (digit >= 'a' && digit <= 'f') {
-            digit -= 'a';
-        } 
-
-        else if (digit == '.') {
-            if (num_data->decimal_point >= 0)
-                assert(!"TODO ERROR");
-            num_data->decimal_point = num_data->digits.size;
-        } 
-
-        else {
-            break;
-        }
-
-        if (digit > num_data->base) {
-            assert(!"TODO ERROR");
-        }
-        num_data->digits.push(digit);
-
-    }
-
-    return num_data;
-}
-
-
 bool tokenize(AST_Context& global, SourceFile &s) {
 	u64 word_start;
 	enum { NONE, WORD, NUMBER } state = NONE;
@@ -240,6 +190,8 @@ bool tokenize(AST_Context& global, SourceFile &s) {
 	struct BracketToken {
         TokenType bracket;
 		u64 tokid;
+        u32 pair_index; // index into s.curly_pairs for '{' and into s.paren_args for '('
+        u32 commas;
 	};
 	arr<BracketToken> bracket_stack;
 
@@ -266,8 +218,7 @@ bool tokenize(AST_Context& global, SourceFile &s) {
 				tok* kw = Perfect_Hash::in_word_set(s.buffer + word_start, i - word_start);
                 TokenType tt = kw ? kw->type : (state == WORD ? TOK_ID : TOK_NUMBER);
 
-                char       *name     = nullptr;
-                NumberData *num_data = nullptr;
+                char *name = nullptr;
 
                 if (tt == TOK_ID) {
                     // TODO ALLOCATION
@@ -275,20 +226,11 @@ bool tokenize(AST_Context& global, SourceFile &s) {
                     name = (char*)malloc(length + 1);
                     memcpy(name, s.buffer + word_start, length);
                     name[length] = 0;
-                } else if (tt == TOK_NUMBER) {
-                    char *pos = s.buffer + word_start;
-                    num_data = parse_number(global, &pos);
                 }
 
-                if (name) {
-                    s.pushToken(
-                        { .type = tt, .name = name },
-                        { .start = word_start, .end = i });
-                } else {
-                    s.pushToken(
-                        { .type = tt, .number_data = num_data },
-                        { .start = word_start, .end = i });
-                }
+                s.pushToken(
+                    { .type = tt, .name = name },
+                    { .start = word_start, .end = i });
 
 				state = NONE;
 			}
@@ -362,10 +304,8 @@ Done:
         else if (ct & (CT_OPERATOR | CT_HELPERTOKEN)) {
             u32 length = 1;
 
-            // We used to use this for skimming
-            // Right now we don't,
-            // but it's still nice to catch unbalanced brakcets during lexing
-            u64 match = 0;
+            // We catch unbalanced brackets during lexing,
+            // and remember where the curly brackets match so function bodies can be skimmed
 
             // Look for two and three char-long operators
             tok* t = nullptr;
@@ -375,8 +315,22 @@ Done:
                 length = 2;
 			switch (c) {
 				case '(': case '[': case '{': {
-					bracket_stack.push({ TOK(c), s._tokens.size});
+                    u32 pair_index = 0;
+                    if (c == '{') {
+                        pair_index = s.curly_pairs.size;
+                        s.curly_pairs.push({ .open = (u32)s.token_count() });
+                    } else if (c == '(') {
+                        pair_index = s.paren_args.size;
+                        s.paren_args.push({ .open = (u32)s.token_count() });
+                    }
+
+					bracket_stack.push({ TOK(c), s.token_count(), pair_index, 0 });
 					break;
+                }
+                case ',': {
+                    if (bracket_stack.size)
+                        bracket_stack.last().commas++;
+                    break;
                 }
 				case ')': case ']': case '}': {
 					if (bracket_stack.size == 0) {
@@ -394,7 +348,14 @@ Done:
 						global.error({ .code = ERR_UNBALANCED_BRACKETS, });
 						return false;
 					}
-                    match = bt.tokid;
+
+                    if (c == '}') {
+                        s.curly_pairs[bt.pair_index].close = (u32)s.token_count();
+                    } else if (c == ')') {
+                        // Nothing between the brackets is no arguments, otherwise there's one more than the commas
+                        bool empty = bt.tokid + 1 == s.token_count();
+                        s.paren_args[bt.pair_index].count = empty ? 0 : bt.commas + 1;
+                    }
 				}
 			}
 
@@ -425,41 +386,79 @@ Done:
 	return true;
 }
 
+u64 SourceFile::token_end(u64 tok_id) {
+    u64 i = _token_starts[tok_id];
+
+    switch (_token_types[tok_id]) {
+        case TOK_ERROR:
+            return i + 1;
+
+        case TOK_STRING_LITERAL: {
+            // The start is past the opening ", the end is past the closing one
+            while (buffer[i] != '"') {
+                if (buffer[i] == '\\')
+                    i++;
+                i++;
+            }
+            return i + 1;
+        }
+
+        default: {
+            if (ctt[buffer[i]] & (CT_LETTER | CT_DIGIT)) {
+                while (i < length && (ctt[buffer[i]] & (CT_LETTER | CT_DIGIT)))
+                    i++;
+                return i;
+            }
+
+            // Operators, the same lookup as in tokenize
+            if (i + 2 < length && Perfect_Hash::in_word_set(buffer + i, 3))
+                return i + 3;
+            if (i + 1 < length && Perfect_Hash::in_word_set(buffer + i, 2))
+                return i + 2;
+            return i + 1;
+        }
+    }
+}
+
 
 struct TokenReader {
 	u64 pos = 0;
-    u64 pos_in_file;
+    u64 last_popped;
 
 	SourceFile& sf;
 	AST_Context& ctx;
 
 	SmallToken peek() {
-		if (pos >= sf._tokens.size)
+		if (pos >= sf.token_count())
 			return  {};
-		return sf._tokens[pos]; 
+		return sf.getSmallToken(pos); 
 	}
     
 	Token peek_full() {
-		if (pos >= sf._tokens.size)
+		if (pos >= sf.token_count())
 			return  {};
 		return sf.getToken(pos); 
 	}
 
 	SmallToken pop() {
-		if (pos >= sf._tokens.size)
+		if (pos >= sf.token_count())
 			return  {};
-        pos_in_file = sf._token_locations[pos].end;
-		return sf._tokens[pos++]; 
+        last_popped = pos;
+		return sf.getSmallToken(pos++); 
 	}
 
 	Token pop_full() {
-		if (pos >= sf._tokens.size)
+		if (pos >= sf.token_count())
 			return  {};
-		Token t = sf.getToken(pos++); 
-        pos_in_file = t.loc.end;
-        return t;
+        last_popped = pos;
+		return sf.getToken(pos++); 
 	}
 
+    // Where the last token that was popped ends
+    u64 pos_in_file() {
+        return sf.token_end(last_popped);
+    }
+
     SmallToken expect(TokenType tt) {
 		SmallToken t = pop();
 
@@ -498,6 +497,13 @@ void unexpected_token(AST_Context& ctx, Token actual, TokenType expected_tt) {
 bool parse_decl_statement(AST_Context& ctx, TokenReader& r, bool* error);
 bool parse_expr(AST_Context& ctx, AST_Value **out, TokenReader& r, TokenType delim);
 
+// The number of comma separated arguments between the reader's position and the matching ')',
+// so a call's argument array can be allocated up front. The tokenizer has counted them already,
+// the reader is right after the '('
+u32 count_call_args(TokenReader& r) {
+    return r.sf.paren_arg_count(r.pos - 1);
+}
+
 bool parse_type_list(AST_Context& ctx, TokenReader& r, TokenType delim, bucketed_arr<StructElement>* tl) {
     SmallToken t = r.peek();
     if (t.type == delim) {
@@ -542,6 +548,22 @@ ParseNodeRet parse_node(AST_Context &ctx, AST_Node **out, TokenReader &r, TokenT
             *out = parse_fn(ctx, r, true);
             return PARSE_NODE_DECL;
         }
+        case KW_EXPORT: {
+            // Only top level functions can be exported
+            r.pop();
+            if (&ctx != &ctx.global || r.peek().type != KW_FN) {
+                unexpected_token(ctx, r.pop_full(), KW_FN);
+                return PARSE_NODE_ERROR;
+            }
+
+            AST_Fn *fn = parse_fn(ctx, r, true);
+            if (!fn)
+                return PARSE_NODE_ERROR;
+
+            fn->is_exported = true;
+            *out = fn;
+            return PARSE_NODE_DECL;
+        }
         case KW_MACRO: {
             *out = parse_macro(ctx, r);
             return PARSE_NODE_DECL;
@@ -576,13 +598,13 @@ ParseNodeRet parse_node(AST_Context &ctx, AST_Node **out, TokenReader &r, TokenT
                     return PARSE_NODE_ERROR;
             }
 
-            r.ctx.global.definition_locations[ret] = {
+            r.ctx.global.set_location(ret, {
                 .file_id = r.sf.id,
                 .loc = {
                     .start = return_tok.loc.start,
-                    .end = r.pos_in_file,
+                    .end = r.pos_in_file(),
                 }
-            };
+            });
 
             if (!r.expect(TOK(';')).type)
                 return PARSE_NODE_ERROR;
@@ -600,13 +622,13 @@ ParseNodeRet parse_node(AST_Context &ctx, AST_Node **out, TokenReader &r, TokenT
             if (!parse_block(ifs->then_block, r))
                 return PARSE_NODE_ERROR;
 
-            r.ctx.global.definition_locations[ifs] = {
+            r.ctx.global.set_location(ifs, {
                 .file_id = r.sf.id,
                 .loc = {
                     .start = if_tok.loc.start,
-                    .end = r.pos_in_file,
+                    .end = r.pos_in_file(),
                 }
-            };
+            });
 
             *out = ifs;
             return PARSE_NODE_STMT;
@@ -621,13 +643,13 @@ ParseNodeRet parse_node(AST_Context &ctx, AST_Node **out, TokenReader &r, TokenT
             if (!parse_block(whiles->block, r))
                 return PARSE_NODE_ERROR;
 
-            r.ctx.global.definition_locations[whiles] = {
+            r.ctx.global.set_location(whiles, {
                 .file_id = r.sf.id,
                 .loc = {
                     .start = while_tok.loc.start,
-                    .end = r.pos_in_file,
+                    .end = r.pos_in_file(),
                 }
-            };
+            });
 
             *out = whiles;
             return PARSE_NODE_STMT;
@@ -682,6 +704,38 @@ bool parse_block(AST_Context& block, TokenReader& r) {
     return true;
 }
 
+// Only bodies of top level functions are skimmed. The body must not declare 
+// functions, macros or structs, as those have to be known right after parsing
+bool can_skim_body(AST_Context& ctx, TokenReader& r) {
+    MUST (&ctx == &ctx.global);
+    MUST (r.peek().type == TOK('{'));
+
+    u64 close = r.sf.matching_curly(r.pos);
+    for (u64 i = r.pos + 1; i < close; i++) {
+        switch (r.sf._token_types[i]) {
+            case KW_FN:
+            case KW_MACRO:
+            case KW_STRUCT:
+                return false;
+            default:
+                break;
+        }
+    }
+    return true;
+}
+
+bool parse_fn_body(AST_Fn *fn) {
+    if (!fn->body_token)
+        return true;
+
+    TokenReader r { .pos = fn->body_token, .sf = sources[fn->body_file_id], .ctx = fn->block };
+    fn->body_token = 0;
+
+    MUST (parse_block(fn->block, r));
+    resolve_pending_ids(fn->block.global);
+    return true;
+}
+
 AST_Fn* parse_fn(AST_Context& ctx, TokenReader& r, bool decl) {
     Token fn_kw = r.expect_full(KW_FN);
 
@@ -696,7 +750,7 @@ AST_Fn* parse_fn(AST_Context& ctx, TokenReader& r, bool decl) {
     }
 
     AST_Fn *fn = ctx.alloc<AST_Fn>(&ctx, nameToken.name);
-    AST_FnType* temp_fn_type = ctx.alloc_temp<AST_FnType>(ctx.global.target.pointer_size);
+    AST_FnType* temp_fn_type = ctx.alloc_temp<AST_FnType>(ctx.global.target.pointer_size, &ctx.global.allocator);
     
     if (decl) {
         ctx.global.fns_to_declare.push({ ctx, fn });
@@ -729,13 +783,13 @@ AST_Fn* parse_fn(AST_Context& ctx, TokenReader& r, bool decl) {
         TokenType p = r.peek().type;
 
         AST_Var* var = ctx.alloc<AST_Var>(nameToken.name, argindex++);
-        ctx.global.definition_locations[var] = {
+        ctx.global.set_location(var, {
             .file_id = r.sf.id,
             .loc = {
                .start = nameToken.loc.start,
-               .end = r.pos_in_file,
+               .end = r.pos_in_file(),
             }
-        };
+        });
 
         // the type of the AST_Var is set by the typer
         MUST (fn->block.declare({ nameToken.name }, var, false));
@@ -767,16 +821,27 @@ AST_Fn* parse_fn(AST_Context& ctx, TokenReader& r, bool decl) {
     }
 
     if (!fn->is_extern) {
-        MUST (parse_block(fn->block, r));
+        if (skim_bodies && can_skim_body(ctx, r)) {
+            // Skip to the matching '}', the body is parsed when the function is typechecked
+            fn->body_file_id = r.sf.id;
+            fn->body_token   = r.pos;
+
+            r.pos = r.sf.matching_curly(r.pos);
+            r.pop();
+        } else {
+            MUST (parse_block(fn->block, r));
+        }
     }
 
-    ctx.global.definition_locations[fn] = {
+    resolve_pending_ids(ctx.global);
+
+    ctx.global.set_location(fn, {
         .file_id = r.sf.id,
         .loc = {
            .start = fn_kw.loc.start,
-           .end = r.pos_in_file,
+           .end = r.pos_in_file(),
         }
-    };
+    });
 
     return fn;
 }
@@ -798,13 +863,13 @@ AST_Macro* parse_macro(AST_Context& ctx, TokenReader& r) {
 
     MUST(ctx.global.declare({ .name = macro->name }, macro, true));
 
-    ctx.global.definition_locations[macro] = {
+    ctx.global.set_location(macro, {
         .file_id = r.sf.id,
         .loc = {
            .start = macro_kw.loc.start,
-           .end = r.pos_in_file,
+           .end = r.pos_in_file(),
         }
-    };
+    });
 
     return macro;
 }
@@ -833,15 +898,10 @@ struct ParseExprState {
         ParseExprValue val = _output.pop();
         *out = val.val;
 
-        if (val.val IS AST_UNRESOLVED_ID) {
-            IdResolveJob _resolve_job(ctx, (AST_UnresolvedId**)out);
-            HeapJob *resolve_job = _resolve_job.heapify<CallResolveJob>();
-
-            ((AST_UnresolvedId*)val.val)->job = resolve_job;
-
-            ctx.subscribers.push(resolve_job);
-            ctx.global.add_job(resolve_job);
-        }
+        // Most identifiers can be resolved right away once the scopes
+        // around them are closed, so we batch them up, see resolve_pending_ids
+        if (val.val IS AST_UNRESOLVED_ID)
+            ctx.global.pending_ids.push((AST_UnresolvedId**)out);
 
         return val;
     };
@@ -861,7 +921,7 @@ bool pop_operator(ParseExprState& state) {
     }
 
     if (op.is_unary) {
-        AST_Call *un = state.ctx.alloc<AST_Call>(FNCALL_UNARY_OP, op.tok.type, nullptr, 1);
+        AST_Call *un = state.ctx.alloc<AST_Call>(FNCALL_UNARY_OP, op.tok.type, nullptr, state.ctx.alloc_array<AST_Value*>(1));
         un->args.size = 1;
         ParseExprValue inner = state.pop_into(&un->args[0]);
 
@@ -872,13 +932,13 @@ bool pop_operator(ParseExprState& state) {
                 inner.loc.loc.end,
             }
         };
-        state.ctx.global.definition_locations[un] = loc;
+        state.ctx.global.set_location(un, loc);
         state._output.push({ un, loc });
         
         return true;
 
     } else {
-        AST_Call *bin = state.ctx.alloc<AST_Call>(FNCALL_BINARY_OP, op.tok.type, nullptr, 2);
+        AST_Call *bin = state.ctx.alloc<AST_Call>(FNCALL_BINARY_OP, op.tok.type, nullptr, state.ctx.alloc_array<AST_Value*>(2));
         bin->args.size = 2;
         ParseExprValue lhs, rhs;
         rhs = state.pop_into(&bin->args[1]);
@@ -891,7 +951,7 @@ bool pop_operator(ParseExprState& state) {
                 rhs.loc.loc.end,
             }
         };
-        state.ctx.global.definition_locations[bin] = loc;
+        state.ctx.global.set_location(bin, loc);
         state._output.push({ bin, loc });
         
         return true;
@@ -949,7 +1009,9 @@ bool parse_expr(AST_Context& ctx, AST_Value **out, TokenReader& r, TokenType del
                         break;
                     }
                     case TOK_NUMBER: {
-                        val = ctx.alloc<AST_NumberLiteral>(t.number_data);
+                        NumberData number_data;
+                        parse_number(r.sf.buffer + t.loc.start, &number_data);
+                        val = ctx.alloc<AST_NumberLiteral>(&number_data);
                         break;
                     }
                     case TOK_STRING_LITERAL: {
@@ -970,8 +1032,8 @@ bool parse_expr(AST_Context& ctx, AST_Value **out, TokenReader& r, TokenType del
 
                 // TODO ALLOCATION we should not be storing the node locations
                 // for the unresolved IDs here, as they'll get discarded
-                if (!ctx.global.definition_locations.find2(val))
-                    ctx.global.definition_locations[val] = loc;
+                if (!val->location_id)
+                    ctx.global.set_location(val, loc);
 
                 state._output.push({val, loc });
                 break;
@@ -985,39 +1047,43 @@ bool parse_expr(AST_Context& ctx, AST_Value **out, TokenReader& r, TokenType del
                         return false;
                     }
 
-                    AST_Call* fncall = ctx.alloc<AST_Call>(FNCALL_REGULAR_FN, TOK(0), nullptr, 4);
+                    u32 args_capacity = count_call_args(r);
+                    AST_Call* fncall = ctx.alloc<AST_Call>(FNCALL_REGULAR_FN, TOK(0), nullptr, ctx.alloc_array<AST_Value*>(args_capacity));
                     ParseExprValue fn = state._output.pop();
 
                     assert(fn.val IS AST_UNRESOLVED_ID);
                     fncall->fn = fn.val;
 
-                    arr<Location> arg_locs;
-
                     while (r.peek().type != TOK(')')) {
-                        AST_Value *& arg = fncall->args.push(nullptr);
+                        // The array can't grow, an argument count_call_args missed would be written past it
+                        if (fncall->args.size >= args_capacity) {
+                            state.ctx.error({ .code = ERR_INVALID_EXPRESSION });
+                            return false;
+                        }
+                        AST_Value *& arg = fncall->args[fncall->args.size++];
+                        arg = nullptr;
                         MUST (parse_expr(ctx, &arg, r, {}));
 
-                        Location argloc = location_of(ctx, (AST_Node**)&arg);
-                        arg_locs.push(argloc);
+                        // Once the identifier is resolved the slot will point to the declaration,
+                        // so we have to remember where it was referenced. Every other argument
+                        // node carries its own location
+                        if (arg IS AST_UNRESOLVED_ID)
+                            ctx.global.reference_locations[(AST_Node**)&arg] = location_of(ctx, (AST_Node**)&arg);
 
                         if (r.peek().type != TOK(')'))
                             MUST (r.expect(TOK(',')).type);
                     }
                     r.pop(); // discard the closing bracket
 
-                    for (u32 i = 0; i < arg_locs.size; i++) {
-                        ctx.global.reference_locations[(AST_Node**)&fncall->args[i]] = arg_locs[i];
-                    }
-
                     Location loc = {
                         .file_id = fn.loc.file_id,
                         .loc = {
                             .start = fn.loc.loc.start,
-                            .end = r.pos_in_file,
+                            .end = r.pos_in_file(),
                         }
                     };
 
-                    r.ctx.global.definition_locations[fncall] = loc;
+                    r.ctx.global.set_location(fncall, loc);
                     state._output.push({ fncall, loc });
                 }
                 
@@ -1057,7 +1123,7 @@ bool parse_expr(AST_Context& ctx, AST_Value **out, TokenReader& r, TokenType del
                 AST_MemberAccess* ma = ctx.alloc<AST_MemberAccess>(nullptr, nameToken.name);
                 ParseExprValue lhs = state.pop_into(&ma->lhs);
 
-                lhs.loc.loc.end = r.pos_in_file;
+                lhs.loc.loc.end = r.pos_in_file();
 
                 state._output.push({ ma, lhs.loc });
                 break;
@@ -1076,12 +1142,12 @@ bool parse_expr(AST_Context& ctx, AST_Value **out, TokenReader& r, TokenType del
                     .file_id = syval.loc.file_id,
                     .loc = {
                         .start = syval.loc.loc.start,
-                        .end = r.pos_in_file,
+                        .end = r.pos_in_file(),
                     }
                 };
 
                 state._output.push({addrof, loc});
-                ctx.global.definition_locations[addrof] = loc;
+                ctx.global.set_location(addrof, loc);
 
                 break;
             }
@@ -1120,13 +1186,13 @@ bool parse_expr(AST_Context& ctx, AST_Value **out, TokenReader& r, TokenType del
 
                             AST_Dereference *deref = ctx.alloc<AST_Dereference>(nullptr);
                             ParseExprValue last = state.pop_into(&deref->ptr);
-                            last.loc.loc.end = r.pos_in_file;
+                            last.loc.loc.end = r.pos_in_file();
 
                             state._output.push({
                                 deref,
                                 last.loc,
                             });
-                            state.ctx.global.definition_locations[deref] = last.loc;
+                            state.ctx.global.set_location(deref, last.loc);
                             prev_was_value = true;
                             break;
                         }
@@ -1193,13 +1259,13 @@ AST_Var *parse_var_decl(AST_Context& ctx, TokenReader& r) {
 
     var->is_global = &ctx.global == &ctx;
 
-    ctx.global.definition_locations[var] = {
+    ctx.global.set_location(var, {
         .file_id = r.sf.id,
         .loc = {
             .start = nameToken.loc.start,
-            .end = r.pos_in_file,
+            .end = r.pos_in_file(),
         }
-    };
+    });
 
     MUST (ctx.declare({ nameToken.name }, var, &ctx == &ctx.global));
     return var;
@@ -1219,11 +1285,11 @@ AST_Struct *parse_struct(AST_Context& ctx, TokenReader& r, bool decl) {
         Token nameToken = r.expect_full(TOK_ID);
         MUST (nameToken.type); 
 
-        st = ctx.alloc<AST_Struct>(nameToken.name);
+        st = ctx.alloc<AST_Struct>(nameToken.name, &ctx.global.allocator);
         declare_succeeded = ctx.declare({ .name = st->name }, st, true);
     }
     else {
-        st = ctx.alloc<AST_Struct>(nullptr);
+        st = ctx.alloc<AST_Struct>(nullptr, &ctx.global.allocator);
     }
 
     MUST (r.expect(TOK('{')).type);
@@ -1236,6 +1302,7 @@ bool parse_source_file(AST_Context& global, SourceFile& sf) {
     TokenReader r { .sf = sf, .ctx = global };
     MUST (tokenize(global, sf));
     MUST (parse_scope(global, r, TOK_NONE));
+    resolve_pending_ids(global.global);
     return true;
 }
 
@@ -29,6 +29,12 @@ OpResolveJob::OpResolveJob(AST_GlobalContext &ctx, AST_Call *call)
 
 
 
+bool arity_compatible(AST_FnType *fntype, u32 argc) {
+    if (fntype->is_variadic)
+        return fntype->param_types.size <= argc;
+    return fntype->param_types.size == argc;
+}
+
 struct MatchCallJob : Job {
     AST_Context *context;
     AST_Fn      *fn;
@@ -54,31 +60,37 @@ struct MatchCallJob : Job {
     bool run(Message *msg) override {
         AST_FnType *fntype = fn->fntype();
 
-        MUST (fntype->param_types.size >= fncall->args.size);
-        if (!fntype->is_variadic)
-            MUST (fntype->param_types.size == fncall->args.size);
-
-        if (prio == 0) {
-            prio = 1000;
-            bool wait = false;
-            for (u32 i = 0; i < fntype->param_types.size; i++) {
-                AST_Type *paramtype = fntype->param_types[i];
-                AST_Type *argtype = fncall->args[i]->type;
-
-                CastJob cast_job(context, fncall->args[i], paramtype, [](Job *self, Job *parent) {
-                    MatchCallJob *p = (MatchCallJob*)parent;
-                    CastJob *c = (CastJob*)self;
-                    p->casted_args[(u64)self->input] = (AST_Value*)self->result;
-                    p->prio += c->prio;
-                });
-
-                cast_job.input = (void*)(u64)i;
-                if (!run_child<MatchCallJob, CastJob>(cast_job, true)) // TODO kill the other cast jobs if this fails
-                    wait = true;
+        if (!arity_compatible(fntype, fncall->args.size)) {
+            set_error_flag();
+            return false;
+        }
+
+        // The casts don't depend on any other jobs, so we look them up
+        // and apply them right here instead of running a CastJob per argument
+        prio = 1000;
+        for (u32 i = 0; i < fncall->args.size; i++) {
+            AST_Value *arg = fncall->args[i];
+
+            // Variadic arguments are passed as they are
+            if (i >= fntype->param_types.size) {
+                casted_args[i] = arg;
+                continue;
+            }
+
+            CastResolution cast = find_cast(arg->type, fntype->param_types[i]);
+            if (!cast.priority) {
+                set_error_flag();
+                return false;
             }
-            if (wait)
+
+            if (!cast.fn) {
+                casted_args[i] = arg;
+            } else if (!cast.fn(global, arg, &casted_args[i])) {
+                set_error_flag();
                 return false;
-        } 
+            }
+            prio += cast.priority;
+        }
         
         return true;
     }
@@ -115,17 +127,18 @@ bool CallResolveJob::spawn_match_job(AST_Fn *fn) {
             NOT_IMPLEMENTED();
         }
 
-        if (parent->pending_matches == 0) {
-            if (parent->context && parent->context->closed) {
-                parent->context = parent->context->parent;
-                parent->read_scope();
-            }
-        }
+        // MatchCallJobs finish immediately, so we're still inside read_scope,
+        // it moves on to the parent scope once all the candidates are matched
     });
 
     the_job.input = 0;
-    if (run_child<CallResolveJob, MatchCallJob>(the_job, false)) // TODO JOB
+    if (run_child<CallResolveJob, MatchCallJob>(the_job, false)) { // TODO JOB
+        // The arguments can't be casted to this overload's parameters,
+        // it's not a candidate, so we're not waiting on it
+        if (the_job.flags & JOB_ERROR)
+            pending_matches--;
         return true;
+    }
 
     the_job.input = (void*)1;
     return false;
@@ -150,6 +163,14 @@ bool key_compatible(DeclarationKey &lhs, DeclarationKey &rhs) {
     return true;
 }
 
+// A function whose parameter types are exactly the argument types
+// doesn't need any casts, so it's the best match we can get
+bool is_exact_match(AST_FnType *fntype, AST_Call *fncall) {
+    for (u32 i = 0; i < fncall->args.size; i++)
+        MUST (fntype->param_types[i] == fncall->args[i]->type);
+    return true;
+}
+
 RunJobResult CallResolveJob::read_scope() {
     if (!context) {
         if (prio > 0) {
@@ -169,13 +190,36 @@ RunJobResult CallResolveJob::read_scope() {
     bool heaped = false;
     CallResolveJob *self = this;
     DeclarationKey key = self->get_decl_key();
+    u32 argc = fncall->args.size;
+
+    arr<AST_Fn*> *fixed    = self->context->overloads.find2({ key.name, argc });
+    arr<AST_Fn*> *variadic = self->context->overloads.find2({ key.name, OVERLOAD_VARIADIC });
+
+    if (fixed) {
+        for (AST_Fn *fn : *fixed) {
+            if (is_exact_match(fn->fntype(), fncall)) {
+                fncall->fn = fn;
+                fncall->type = fn->fntype()->returntype;
+                job_done();
+                return RUN_DONE;
+            }
+        }
 
-    for (auto &kvp : self->context->declarations)
-        if (kvp.value IS AST_FN && key_compatible(key, kvp.key))
-            if (!self->spawn_match_job((AST_Fn*)kvp.value) && !heaped) {
+        for (AST_Fn *fn : *fixed)
+            if (!self->spawn_match_job(fn) && !heaped) {
                 heaped = true;
                 self = (CallResolveJob*)heapify<CallResolveJob>()->job();
             }
+    }
+
+    if (variadic) {
+        for (AST_Fn *fn : *variadic)
+            if (arity_compatible(fn->fntype(), argc))
+                if (!self->spawn_match_job(fn) && !heaped) {
+                    heaped = true;
+                    self = (CallResolveJob*)heapify<CallResolveJob>()->job();
+                }
+    }
     
     if (self->context) {
         if (pending_matches == 0 && self->context->closed) {
@@ -191,28 +235,58 @@ RunJobResult CallResolveJob::read_scope() {
     return RUN_AGAIN;
 }
 
+// Walk up the scopes looking for the declaration. We can only move past
+// a scope once it's closed, otherwise the name may still get declared in it
+bool IdResolveJob::try_resolve() {
+    while (context) {
+        AST_Node *decl;
+        if (context->declarations.find({ .name = (*unresolved_id)->name }, &decl)) {
+            *(AST_Node**)unresolved_id = decl;
+            return true;
+        }   
+
+        if (!context->closed)
+            return false;
+
+        context = context->parent;
+    }
+    return false;
+}
+
+void resolve_pending_ids(AST_GlobalContext &global) {
+    for (AST_UnresolvedId **slot : global.pending_ids) {
+        AST_UnresolvedId *id = *slot;
+
+        IdResolveJob _resolve_job(id->ctx, slot);
+        if (_resolve_job.try_resolve())
+            continue;
+
+        // A forward reference, wait for the declaration
+        HeapJob *resolve_job = _resolve_job.heapify<IdResolveJob>();
+        id->job = resolve_job;
+
+        // The global scope isn't closed while we're still parsing
+        assert(_resolve_job.context);
+        _resolve_job.context->subscribers.push(resolve_job);
+        global.add_job(resolve_job);
+    }
+    global.pending_ids.size = 0;
+}
+
 bool IdResolveJob::run(Message *msg) {
 Top:
     if (!msg) {
+        if (try_resolve())
+            return true;
+
         if (!context) {
             // TODO ERROR
             set_error_flag();
             return false;
         }
 
-        AST_Node *decl;
-        if (context->declarations.find({ .name = (*unresolved_id)->name }, &decl)) {
-            *(AST_Node**)unresolved_id = decl;
-            return true;
-        }   
-
-        if (context->closed) {
-            context = context->parent;
-            return run(nullptr);
-        } else {
-            context->subscribers.push(heapify<CallResolveJob>());
-            return RUN_AGAIN;
-        }
+        context->subscribers.push(heapify<IdResolveJob>());
+        return RUN_AGAIN;
     }
 
     switch (msg->msgtype) {
@@ -260,10 +334,10 @@ bool CallResolveJob::run(Message *msg) {
             DeclarationKey key = get_decl_key();
 
             if (key_compatible(key, decl->key)) {
-                if (decl->node IS AST_FN)
+                if (decl->node IS AST_FN && arity_compatible(((AST_Fn*)decl->node)->fntype(), fncall->args.size))
                     spawn_match_job((AST_Fn*)decl->node);
-                return false;
             }
+            return false;
         }
 
         case MSG_SCOPE_CLOSED: {
@@ -295,6 +369,10 @@ RunJobResult OpResolveJob::try_binary_builder(TIR_Builder *builder, AST_Type *ta
         TIR_Builder *builder;
     };
 
+    // Don't bother spawning a CastJob if there's no cast between the types
+    if (!find_cast(fncall->args[cast_rhs ? 1 : 0]->type, targettype).priority)
+        return RUN_FAIL;
+
     pending_matches ++;
     CastJob the_cast(&global, fncall->args[cast_rhs ? 1 : 0], targettype, [](Job *_self, Job *_parent) {
         CastJob *self = (CastJob*)_self;
@@ -326,7 +404,7 @@ RunJobResult OpResolveJob::try_binary_builder(TIR_Builder *builder, AST_Type *ta
     asdf->other = this->fncall->args[cast_rhs ? 0 : 1];
     asdf->builder = builder;
 
-    bool r = run_child<CastJob>(the_cast, false); // TODO JOB
+    bool r = run_child<OpResolveJob, CastJob>(the_cast, false); // TODO JOB
     return RUN_AGAIN;
 }
 
@@ -349,6 +427,21 @@ bool OpResolveJob::run(Message *msg) {
     if (!msg) {
         switch (fncall->args.size) {
             case 2: {
+                // Fast path - both operands are primitives, the operator has already been resolved
+                BinaryOpResolution *res = find_primitive_binary_op(fncall->op, fncall->args[0]->type, fncall->args[1]->type);
+                if (res) {
+                    AST_Value **operand = &fncall->args[res->cast_rhs ? 1 : 0];
+
+                    // Casting number literals can fail if they don't fit, 
+                    // in that case we look for another builder below
+                    if (!res->cast || res->cast(global, *operand, operand)) {
+                        fncall->builder = res->builder;
+                        fncall->type = res->builder->rettype;
+                        job_done();
+                        return RUN_DONE;
+                    }
+                }
+
                 TIR_Builder *builder = nullptr;
 
                 if (binary_builders.find( 
@@ -9,10 +9,15 @@ struct IdResolveJob : Job {
 
     IdResolveJob(AST_Context &ctx, AST_UnresolvedId **id);
 
+    bool try_resolve();
     bool run(Message *msg) override;
     std::wstring get_name() override;
 };
 
+// Resolve the identifiers in global.pending_ids through the scope chain,
+// IdResolveJobs are only spawned for the ones that may be declared later
+void resolve_pending_ids(AST_GlobalContext &global);
+
 struct CallResolveJob : Job {
     AST_Call          *fncall;
     AST_Context       *context;
@@ -54,6 +54,112 @@ bool test_arr_destructs_after_arr_destroyed() {
     return element.state == Foo::Destroyed;
 }
 
+bool test_arr_allocates_on_first_push() {
+    arr<u64> the_array;
+    if (the_array.buffer)
+        return false;
+
+    the_array.push(1);
+    return the_array.buffer && the_array.size == 1;
+}
+
+bool test_arr_push_own_element() {
+    arr<std::wstring> the_array;
+    the_array.push(L"first");
+
+    // Every push of the first element reallocates once the arr is full
+    for (u32 i = 0; i < 100; i++)
+        the_array.push(the_array[0]);
+
+    return the_array.size == 101 && the_array.last() == L"first";
+}
+
+bool test_small_arr_stays_inline() {
+    small_arr<u64, 2> the_array;
+    the_array.push(1);
+    the_array.push(2);
+    if (!the_array.is_inline())
+        return false;
+
+    the_array.push(3);
+    return !the_array.is_inline() && the_array[0] == 1 && the_array[2] == 3;
+}
+
+bool test_small_arr_move() {
+    small_arr<u64, 2> inline_array = { 1, 2 };
+    small_arr<u64, 2> moved_inline(std::move(inline_array));
+
+    small_arr<u64, 2> heap_array = { 1, 2, 3 };
+    u64 *heap_buffer = heap_array.buffer;
+    small_arr<u64, 2> moved_heap(std::move(heap_array));
+
+    return moved_inline.is_inline() && moved_inline.size == 2 && moved_inline[1] == 2
+        && moved_heap.buffer == heap_buffer && moved_heap.size == 3
+        && heap_array.is_inline() && heap_array.size == 0;
+}
+
+bool test_bucketed_arr_move() {
+    // Past the inline elements, so the buckets are malloced and have to change hands
+    bucketed_arr<u64> *a = new bucketed_arr<u64>();
+    for (u64 i = 0; i < 20; i++)
+        a->push(i);
+
+    bucketed_arr<u64> moved(std::move(*a));
+    bool moved_from_empty = a->size == 0 && a->buckets.size == 0;
+    delete a;
+
+    for (u64 i = 0; i < 20; i++)
+        if (moved[i] != i)
+            return false;
+    return moved_from_empty && moved.size == 20;
+}
+
+bool test_bucketed_arr_iterates_full_buckets() {
+    // 4 inline elements and buckets of 4, 8, 16: every one of these sizes ends on a full bucket
+    for (u32 count : { 4u, 8u, 16u, 32u, 33u }) {
+        bucketed_arr<u32> a;
+        for (u32 i = 0; i < count; i++)
+            a.push(i);
+
+        u32 seen = 0;
+        for (u32 x : a) {
+            if (x != seen)
+                return false;
+            seen++;
+        }
+        if (seen != count)
+            return false;
+    }
+    return true;
+}
+
+bool test_bucketed_arr_random_access() {
+    bucketed_arr<u32> a;
+    for (u32 i = 0; i < 1000; i++)
+        a.push(i * 3);
+
+    for (u32 i = 0; i < 1000; i++)
+        if (a[i] != i * 3)
+            return false;
+    return true;
+}
+
+bool test_bucketed_arr_stable_addresses() {
+    linear_alloc alloc;
+    bucketed_arr<u64> a(&alloc);
+    a.push(1);
+    a.push(2);
+    a.push(3);
+    a.push(4);
+    a.push(5);
+
+    u64 *fifth = &a[4];
+    for (u64 i = 0; i < 500; i++)
+        a.push(i);
+
+    return &a[4] == fifth && *fifth == 5;
+}
+
 void ok(bool is_ok) {
     if (is_ok) {
         wcout << "OK\n";
@@ -68,6 +174,30 @@ void run_ds_tests() {
 
         wcout << "Test case test_arr_destructs_after_arr_destroyed... ";
         ok(test_arr_destructs_after_arr_destroyed());
+
+        wcout << "Test case test_arr_allocates_on_first_push... ";
+        ok(test_arr_allocates_on_first_push());
+
+        wcout << "Test case test_arr_push_own_element... ";
+        ok(test_arr_push_own_element());
+
+        wcout << "Test case test_small_arr_stays_inline... ";
+        ok(test_small_arr_stays_inline());
+
+        wcout << "Test case test_small_arr_move... ";
+        ok(test_small_arr_move());
+
+        wcout << "Test case test_bucketed_arr_move... ";
+        ok(test_bucketed_arr_move());
+
+        wcout << "Test case test_bucketed_arr_iterates_full_buckets... ";
+        ok(test_bucketed_arr_iterates_full_buckets());
+
+        wcout << "Test case test_bucketed_arr_random_access... ";
+        ok(test_bucketed_arr_random_access());
+
+        wcout << "Test case test_bucketed_arr_stable_addresses... ";
+        ok(test_bucketed_arr_stable_addresses());
 }
 
 
@@ -1,7 +1,10 @@
 #include "tir.h"
 #include "typer.h"
+#include "tir_profile.h"
 #include <iostream>
 #include <sstream>
+#include <chrono>
+#include <algorithm>
 
 TIR_Value::operator bool() { return valuespace; }
 bool operator== (TIR_Value& lhs, TIR_Value& rhs) {
@@ -127,28 +130,28 @@ std::wostream& operator<< (std::wostream& o, TIR_Instruction& instr) {
                 default: UNREACHABLE;
             }
 
-            o << instr.bin.rhs << std::endl;
+            o << instr.bin.rhs << "\n";
             return o;
     }
 
     switch (instr.opcode) {
         case TOPC_MOV:
-            o << instr.un.dst << " <- " << instr.un.src << std::endl;
+            o << instr.un.dst << " <- " << instr.un.src << "\n";
             break;
         case TOPC_BITCAST:
-            o << instr.un.dst << " <- bitcast " << instr.un.src << std::endl;
+            o << instr.un.dst << " <- bitcast " << instr.un.src << "\n";
             break;
         case TOPC_SEXT:
-            o << instr.un.dst << " <- sext " << instr.un.src << std::endl;
+            o << instr.un.dst << " <- sext " << instr.un.src << "\n";
             break;
         case TOPC_ZEXT:
-            o << instr.un.dst << " <- zext " << instr.un.src << std::endl;
+            o << instr.un.dst << " <- zext " << instr.un.src << "\n";
             break;
         case TOPC_LOAD:
-            o << instr.un.dst << " <- load " << instr.un.src << std::endl;
+            o << instr.un.dst << " <- load " << instr.un.src << "\n";
             break;
         case TOPC_STORE:
-            o << "store " << instr.un.src << " -> " << instr.un.dst << std::endl;
+            o << "store " << instr.un.src << " -> " << instr.un.dst << "\n";
             break;
         case TOPC_GEP: {
             o << instr.gep.dst << " <- GEP " << instr.gep.base << "";
@@ -158,7 +161,7 @@ std::wostream& operator<< (std::wostream& o, TIR_Instruction& instr) {
             break;
         }
         case TOPC_RET:
-            o << "ret" << std::endl;
+            o << "ret" << "\n";
             break;
 
         case TOPC_CALL: {
@@ -180,14 +183,14 @@ std::wostream& operator<< (std::wostream& o, TIR_Instruction& instr) {
         }
 
         case TOPC_JMP: {
-            o << "jmp " << "block" << instr.jmp.next_block->id << std::endl;
+            o << "jmp " << "block" << instr.jmp.next_block->id << "\n";
             break;
         }
 
         case TOPC_JMPIF: {
             o << "if " << instr.jmpif.cond 
               << " jmp block" << instr.jmpif.then_block->id
-              << " else block" << instr.jmpif.else_block->id << std::endl;
+              << " else block" << instr.jmpif.else_block->id << "\n";
             break;
         }
 
@@ -197,27 +200,61 @@ std::wostream& operator<< (std::wostream& o, TIR_Instruction& instr) {
     return o;
 }
 
-void TIR_Function::print() {
+const char *tir_opcode_name(TIR_OpCode opcode) {
+    if ((opcode & TOPC_BINARY) == TOPC_BINARY) {
+        static const char *untyped[]   = { "add",  "sub",  "mul",  "div",  "mod",  "shl",  "shr",  "eq",  "lt",  "lte",  "gt",  "gte"  };
+        static const char *unsigned_[] = { "uadd", "usub", "umul", "udiv", "umod", "ushl", "ushr", "ueq", "ult", "ulte", "ugt", "ugte" };
+        static const char *signed_[]   = { "sadd", "ssub", "smul", "sdiv", "smod", "sshl", "sshr", "seq", "slt", "slte", "sgt", "sgte" };
+        static const char *float_[]    = { "fadd", "fsub", "fmul", "fdiv", "fmod", "fshl", "fshr", "feq", "flt", "flte", "fgt", "fgte" };
+
+        u32 op = opcode & 0xFF;
+        if (op >= sizeof(untyped) / sizeof(*untyped))
+            return "?";
+
+        if (opcode & TOPC_FLOAT)    return float_[op];
+        if (opcode & TOPC_SIGNED)   return signed_[op];
+        if (opcode & TOPC_UNSIGNED) return unsigned_[op];
+        return untyped[op];
+    }
+
+    switch (opcode) {
+        case TOPC_NONE:    return "none";
+        case TOPC_MOV:     return "mov";
+        case TOPC_BITCAST: return "bitcast";
+        case TOPC_ZEXT:    return "zext";
+        case TOPC_SEXT:    return "sext";
+        case TOPC_JMPIF:   return "jmpif";
+        case TOPC_JMP:     return "jmp";
+        case TOPC_RET:     return "ret";
+        case TOPC_LOAD:    return "load";
+        case TOPC_STORE:   return "store";
+        case TOPC_CALL:    return "call";
+        case TOPC_GEP:     return "gep";
+        default:           return "?";
+    }
+}
+
+void TIR_Function::print(std::wostream& o) {
     if (ast_fn->is_extern) {
-        wcout << "extern fn " << ast_fn->name << "...\n";
+        o << "extern fn " << ast_fn->name << "...\n";
         return;
     }
 
-    wcout << "fn " << ast_fn->name << "(";
+    o << "fn " << ast_fn->name << "(";
 
     for (TIR_Value& param : parameters) {
-        wcout << param << ", ";
+        o << param << ", ";
     }
     if (parameters.size)
-        wcout << "\b\b \b";
-    wcout << ")\n";
+        o << "\b\b \b";
+    o << ")\n";
 
 
     for (TIR_Block* block : blocks) {
         if (blocks.size > 1)
-            wcout << "  block" << block->id << ":\n";
+            o << "  block" << block->id << ":\n";
         for (auto& instr : block->instructions)
-            wcout << instr;
+            o << instr;
     }
 }
 
@@ -536,6 +573,7 @@ TIR_Value compile_node_rvalue(TIR_Function& fn, AST_Node* node, TIR_Value dst) {
             assert(fncall->fn IS AST_FN);
             AST_Fn *callee = (AST_Fn*)fncall->fn;
             tir_callee = fn.tir_context->fns[callee];
+            fn.tir_context->demand_fn(tir_callee);
 
             if (!dst && fn.retval) {
                 dst = fn.alloc_temp(fn.retval.type);
@@ -861,20 +899,59 @@ struct TIR_GlobalVarInitJob : TIR_ExecutionJob {
     }
 };
 
-HeapJob *TIR_Context::compile_fn(AST_Fn *fn, HeapJob *fn_typecheck_job) {
+bool is_exported(AST_Fn *fn) {
+    return fn->is_exported || (fn->name && !strcmp(fn->name, "main"));
+}
+
+TIR_Function *TIR_Context::add_fn(AST_Fn *fn, HeapJob *fn_typecheck_job) {
     TIR_Function* tir_fn = new TIR_Function(this, fn);
+    tir_fn->typecheck_job = fn_typecheck_job;
     fns.insert(fn, tir_fn);
+    return tir_fn;
+}
+
+HeapJob *TIR_Context::demand_fn(TIR_Function *tir_fn) {
+    if (tir_fn->compile_job)
+        return tir_fn->compile_job;
+
+    if (tir_fn->body_unchecked) {
+        tir_fn->body_unchecked = false;
+
+        TypeCheckJob _body_job(*tir_fn->ast_fn->block.parent, tir_fn->ast_fn);
+        _body_job.declared = true;
+        HeapJob *body_job = _body_job.heapify<TypeCheckJob>();
+
+        if (!(tir_fn->typecheck_job->job()->flags & JOB_DONE))
+            body_job->add_dependency(tir_fn->typecheck_job, true);
+        global.add_job(body_job);
+        tir_fn->typecheck_job = body_job;
+    }
 
     TIR_FnCompileJob _compile_job(tir_fn);
     HeapJob *compile_job = _compile_job.heapify<TIR_FnCompileJob>();
+    tir_fn->compile_job = compile_job;
 
-    compile_job->add_dependency(fn_typecheck_job, true);
-    tir_fn->tir_context->global.add_job(compile_job);
+    if (tir_fn->typecheck_job && !(tir_fn->typecheck_job->job()->flags & JOB_DONE))
+        compile_job->add_dependency(tir_fn->typecheck_job, true);
 
-    tir_fn->compile_job = compile_job;
+    // A function can only be demanded by a function that's still being compiled,
+    // so the group can't have completed yet
+    if (all_compiled) {
+        assert(!(all_compiled->job()->flags & JOB_DONE));
+        all_compiled->add_dependency(compile_job, true);
+    }
+
+    global.add_job(compile_job);
+
+    if (consumer)
+        consumer->on_fn_demanded(tir_fn);
     return compile_job;
 }
 
+HeapJob *TIR_Context::compile_fn(AST_Fn *fn, HeapJob *fn_typecheck_job) {
+    return demand_fn(add_fn(fn, fn_typecheck_job));
+}
+
 
 TIR_Value TIR_Context::append_global(AST_Var *var) {
     TIR_Value val = {
@@ -982,20 +1059,52 @@ void *TIR_ExecutionJob::StackFrame::get_value(TIR_Value key) {
     }
 }
 
+static u64 now_ns() {
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// The interpreter keeps every value in 64 bits, so the result of an operation on a narrower
+// type has to be cut down to it, and sign extended if it's signed, to wrap around like compiled code does
+static void *wrap_to_type(void *val, AST_Type *type) {
+    if (!type || type->nodetype != AST_PRIMITIVE_TYPE || type->size >= 8)
+        return val;
+
+    u64 bits = type->size * 8;
+    u64 mask = (1ull << bits) - 1;
+    u64 v = (u64)val & mask;
+
+    if (((AST_PrimitiveType*)type)->kind == PRIMITIVE_SIGNED && (v >> (bits - 1)) & 1)
+        v |= ~mask;
+    return (void*)v;
+}
+
 void TIR_ExecutionJob::call(TIR_Function *fn, arr<void*> &args) {
+    // release_lowered should have been off if anything was going to be interpreted
+    assert(!fn->body_released);
+
     stackframes.push({
         .fn = fn,
         .block = nullptr,
         .next_instruction = 0,
-        .stack = (u8*)malloc(fn->stack_size),
+        .stack = nullptr,
         .args = args,
-        .tmp = arr<void*>(fn->temps_count),
     });
 }
 
 bool TIR_ExecutionJob::run(Message *message) {
     assert(!message);
 
+    // run returns from a lot of places, this adds the time to exec_ns on all of them
+    struct ExecTimer {
+        u64 &total;
+        u64 start;
+        ~ExecTimer() { total += now_ns() - start; }
+    } timer { tir_context->exec_ns, now_ns() };
+
+    TIR_ExecStats *stats = tir_context->exec_stats;
+    TIR_Profile *profile = tir_context->profile;
+
 NextFrame:
     if (stackframes.size == 0) {
         on_complete(next_retval);
@@ -1005,12 +1114,32 @@ NextFrame:
     while (true) {
         StackFrame &sf = stackframes.last();
 
-        if (!sf.block)
+        // main is called before it's compiled, so the frame's storage 
+        // can only be sized once the function starts running
+        if (!sf.block) {
             sf.block = sf.fn->blocks[0];
+            sf.stack = (u8*)malloc(sf.fn->stack_size);
+            sf.tmp = arr<void*>(sf.fn->temps_count);
+
+            if (stats) {
+                if (sf.fn->exec_calls++ == 0)
+                    stats->fns.push(sf.fn);
+                sf.fn->exec_depth++;
+                sf.entered_ns = now_ns();
+                sf.callee_ns = 0;
+            }
+        }
 
         assert(sf.next_instruction < sf.block->instructions.size);
         TIR_Instruction &instr = sf.block->instructions[sf.next_instruction];
 
+        // A call is run a second time to pick up the callee's return value, that's not counted
+        if (stats && !(instr.opcode == TOPC_CALL && has_next_retval))
+            stats->opcode_counts[instr.opcode]++;
+
+        if (profile && --profile->countdown == 0)
+            profile->sample(this);
+
         if ((instr.opcode & TOPC_BINARY) == TOPC_BINARY) {
             void *lhs = sf.get_value(instr.bin.lhs);
             void *rhs = sf.get_value(instr.bin.rhs);
@@ -1043,10 +1172,19 @@ NextFrame:
                     NOT_IMPLEMENTED();
             }
 
-            sf.set_value(instr.bin.dst, val);
+            sf.set_value(instr.bin.dst, wrap_to_type(val, instr.bin.dst.type));
         } else {
             switch (instr.opcode) {
                 case TOPC_RET: {
+                    if (stats) {
+                        u64 elapsed = now_ns() - sf.entered_ns;
+                        sf.fn->exec_exclusive_ns += elapsed - sf.callee_ns;
+                        if (--sf.fn->exec_depth == 0)
+                            sf.fn->exec_inclusive_ns += elapsed;
+                        if (stackframes.size > 1)
+                            stackframes[stackframes.size - 2].callee_ns += elapsed;
+                    }
+
                     free(sf.stack);
                     stackframes.pop();
                     has_next_retval = true;
@@ -1177,6 +1315,68 @@ NextFrame:
     }
 }
 
+void tir_fn_name(TIR_Function *fn, char *buf, size_t size) {
+    if (fn->ast_fn)
+        snprintf(buf, size, "%s/%u", fn->ast_fn->name, (u32)fn->ast_fn->fntype()->param_types.size);
+    else
+        snprintf(buf, size, "<initializer>");
+}
+
+void print_tir_stats(TIR_Context &tir_context) {
+    TIR_ExecStats *stats = tir_context.exec_stats;
+    if (!stats)
+        return;
+
+    struct OpCount {
+        u32 opcode;
+        u64 count;
+    };
+    arr<OpCount> ops;
+    u64 total = 0;
+
+    for (u32 i = 0; i < 0x10000; i++) {
+        if (stats->opcode_counts[i]) {
+            ops.push({ i, stats->opcode_counts[i] });
+            total += stats->opcode_counts[i];
+        }
+    }
+    std::sort(ops.begin(), ops.end(), [](const OpCount &a, const OpCount &b) { return a.count > b.count; });
+
+    fprintf(stderr, "--------- TIR stats ---------\n");
+    fprintf(stderr, "%llu instructions in %.3f ms\n", (unsigned long long)total, tir_context.exec_ns / 1e6);
+    fprintf(stderr, "%-10s %14s %7s\n", "opcode", "count", "%");
+    for (OpCount &op : ops)
+        fprintf(stderr, "%-10s %14llu %7.2f\n", tir_opcode_name((TIR_OpCode)op.opcode), (unsigned long long)op.count, 100.0 * op.count / total);
+
+    arr<TIR_Function*> fns = stats->fns;
+    std::sort(fns.begin(), fns.end(), [](TIR_Function *a, TIR_Function *b) { return a->exec_exclusive_ns > b->exec_exclusive_ns; });
+
+    fprintf(stderr, "\n%-24s %12s %14s %14s\n", "function", "calls", "inclusive ms", "exclusive ms");
+    for (TIR_Function *fn : fns) {
+        char name[64];
+        tir_fn_name(fn, name, sizeof(name));
+
+        fprintf(stderr, "%-24s %12llu %14.3f %14.3f\n", name, (unsigned long long)fn->exec_calls,
+                fn->exec_inclusive_ns / 1e6, fn->exec_exclusive_ns / 1e6);
+    }
+}
+
+void TIR_Function::release_body() {
+    for (TIR_Block *block : blocks) {
+        for (TIR_Instruction &instr : block->instructions) {
+            if (instr.opcode == TOPC_CALL)
+                free(instr.call.args.buffer);
+            else if (instr.opcode == TOPC_GEP)
+                free(instr.gep.offsets.buffer);
+        }
+        delete block;
+    }
+    blocks = arr<TIR_Block*>(0);
+    stack = arr<VarValTuple>(0);
+    writepoint = nullptr;
+    body_released = true;
+}
+
 TIR_Function::TIR_Function(std::initializer_list<TIR_Instruction> instrs) {
     tir_context = nullptr;
     ast_fn = nullptr;
@@ -168,7 +168,7 @@ struct TIR_Block {
 
     // A list of all blocks that can jump into this one
     // This is used to generate the PHI instructions in LLVM
-    arr<TIR_Block*> previous_blocks;
+    small_arr<TIR_Block*, 2> previous_blocks;
 
     TIR_Block();
 
@@ -176,11 +176,29 @@ struct TIR_Block {
 };
 
 struct TIR_Function;
+struct TIR_Profile;
+struct TIR_ProfileNode;
 
 struct TIR_ExecutionStorage {
     map<u64, void*> global_values;
 };
 
+// What the interpreter did, only collected with --tir-stats.
+// The per function numbers are kept on the TIR_Function itself
+struct TIR_ExecStats {
+    u64 opcode_counts[0x10000] = {};
+
+    // Every function that has been called, in the order of their first call.
+    // This includes the pseudo functions of the global initializers, which aren't in TIR_Context::fns
+    arr<TIR_Function*> fns;
+};
+
+// A backend that lowers each function as soon as its TIR is ready, instead of
+// waiting for the whole program. It's told about every function that gets demanded
+struct TIR_Consumer {
+    virtual void on_fn_demanded(TIR_Function *tir_fn) = 0;
+};
+
 struct TIR_Context {
     AST_GlobalContext &global;
     map<AST_Fn*, TIR_Function*> fns;
@@ -194,13 +212,31 @@ struct TIR_Context {
 
     TIR_ExecutionStorage storage;
 
+    // Time spent in TIR_ExecutionJob::run, by all jobs together
+    u64 exec_ns = 0;
+    TIR_ExecStats *exec_stats = nullptr;
+    TIR_Profile   *profile = nullptr;
+
+    // Every TIR_FnCompileJob is added as a dependency to this group
+    HeapJob *all_compiled = nullptr;
+    TIR_Consumer *consumer = nullptr;
+
     void compile_all(); // TODO DELETE
     HeapJob *compile_fn(AST_Fn *fn, HeapJob *fn_typecheck_job);
 
+    // add_fn only registers the function, it's lowered to TIR once demand_fn is called on it.
+    // Calls demand their callee when they're compiled, so with --demand-driven 
+    // only the roots are demanded up front (see is_exported)
+    TIR_Function *add_fn(AST_Fn *fn, HeapJob *fn_typecheck_job);
+    HeapJob *demand_fn(TIR_Function *tir_fn);
+
     TIR_Value append_global(AST_Var *var);
 
 };
 
+// main and the functions marked with 'export' are visible outside of the module
+bool is_exported(AST_Fn *fn);
+
 void add_string_global(TIR_Context *tir_context, AST_Var *the_string_var, AST_StringLiteral *the_string_literal);
 
 struct TIR_Function {
@@ -210,13 +246,31 @@ struct TIR_Function {
     TIR_Value retval = { .valuespace = TVS_RET_VALUE };
     TIR_Block* writepoint;
     u64 temps_count = 0;
-    HeapJob *compile_job;
+
+    // compile_job is null until the function is demanded
+    HeapJob *typecheck_job = nullptr;
+    HeapJob *compile_job = nullptr;
+
+    // With --demand-driven typecheck_job has only declared the function,
+    // demand_fn replaces it with a job that typechecks the body
+    bool body_unchecked = false;
 
     // right now only set for th efunctions generated by tir_builtins.cpp
     AST_Type *returntype;
 
     bool is_inline = false;
 
+    // Set by release_body, the interpreter can't run it anymore
+    bool body_released = false;
+
+    // Set by the interpreter when there are exec_stats.
+    // inclusive_ns is only added to when the outermost call of a recursion returns,
+    // so it's the time the function was anywhere on the stack
+    u64 exec_calls = 0;
+    u64 exec_inclusive_ns = 0;
+    u64 exec_exclusive_ns = 0;
+    u32 exec_depth = 0;
+
     struct VarValTuple {
         AST_Var *var;
         TIR_Value val;
@@ -241,7 +295,10 @@ struct TIR_Function {
     void compile_signature();
     void compile();
 
-    void print();
+    // Frees the blocks once the backend has lowered them, the signature stays
+    void release_body();
+
+    void print(std::wostream& o);
 };
 
 struct TIR_Builder {
@@ -253,7 +310,7 @@ struct TIR_Builder {
     virtual TIR_Value emit1(TIR_Function &tirfn, arr<TIR_Value> &args, TIR_Value dst) {
         UNREACHABLE;
     }
-    virtual TIR_Value emit2(TIR_Function &tirfn, arr<AST_Value*> &args, TIR_Value dst) {
+    virtual TIR_Value emit2(TIR_Function &tirfn, arr_ref<AST_Value*> &args, TIR_Value dst) {
         UNREACHABLE;
     }
 };
@@ -268,6 +325,13 @@ struct TIR_ExecutionJob : Job {
         u8           *stack;
         arr<void*>    args, tmp;
 
+        // Only kept with exec_stats. callee_ns is the time spent in the functions this one called
+        u64           entered_ns;
+        u64           callee_ns;
+
+        // Where this frame is in the profile's call tree, set once a sample has been taken in it
+        TIR_ProfileNode *profile_node;
+
         void  set_value(TIR_Value key, void *val);
         void *get_value(TIR_Value key); // TODO POINTERSIZE
     };
@@ -276,6 +340,9 @@ struct TIR_ExecutionJob : Job {
     bool has_next_retval = false;
     void *next_retval = nullptr;
 
+    // The root of this job's call tree, set on the job's first profile sample
+    TIR_ProfileNode *profile_root = nullptr;
+
     TIR_ExecutionJob(TIR_Context *tir_context);
 
     arr<StackFrame> stackframes;
@@ -289,6 +356,16 @@ TIR_Value compile_node_rvalue(TIR_Function& fn, AST_Node* node, TIR_Value dst);
 bool get_location(TIR_Function &fn, AST_Value *val, TIR_Value *out);
 
 
+// Lower case and with the type prefix, e.g. "uadd" for TOPC_UADD
+const char *tir_opcode_name(TIR_OpCode opcode);
+
+// Like "fib/1", the parameter count tells most overloads apart.
+// The pseudo functions of the global initializers are "<initializer>"
+void tir_fn_name(TIR_Function *fn, char *buf, size_t size);
+
+// Prints the opcode histogram and the per function calls and times to stderr
+void print_tir_stats(TIR_Context &tir_context);
+
 std::wostream& operator<< (std::wostream& o, TIR_Value loc);
 std::wostream& operator<< (std::wostream& o, TIR_Instruction& instr);
 
@@ -17,6 +17,118 @@ map <BinaryOpKey, TIR_Builder*> binary_builders;
 map<TypePair, BuiltinCast>  builtin_casts;
 
 
+#define BINARY_OP_TABLE_OPS   5
+#define BINARY_OP_TABLE_TYPES 9
+
+BinaryOpResolution primitive_binary_ops[BINARY_OP_TABLE_OPS][BINARY_OP_TABLE_TYPES][BINARY_OP_TABLE_TYPES];
+
+// The table is indexed by the type's size and signedness, so we don't have to hash anything
+// u8, u16, u32, u64 are 0-3, i8, i16, i32, i64 are 4-7, number literals are 8
+int binary_op_table_type_index(AST_Type *type) {
+    if (type == &t_number_literal)
+        return 8;
+    if (!(type IS AST_PRIMITIVE_TYPE))
+        return -1;
+
+    AST_PrimitiveType *prim = (AST_PrimitiveType*)type;
+    int size_index;
+    switch (prim->size) {
+        case 1: size_index = 0; break;
+        case 2: size_index = 1; break;
+        case 4: size_index = 2; break;
+        case 8: size_index = 3; break;
+        default: return -1;
+    }
+
+    switch (prim->kind) {
+        case PRIMITIVE_UNSIGNED: return size_index;
+        case PRIMITIVE_SIGNED:   return size_index + 4;
+        default:                 return -1;
+    }
+}
+
+int binary_op_table_op_index(TokenType op) {
+    switch (op) {
+        case '+': return 0;
+        case '-': return 1;
+        case '*': return 2;
+        case '/': return 3;
+        case '%': return 4;
+        default:  return -1;
+    }
+}
+
+BinaryOpResolution resolve_primitive_binary_op(TokenType op, AST_Type *lhs, AST_Type *rhs);
+
+// The table is filled in on the first lookup and not by the static Initializer,
+// the primitive types are defined in typer.cpp and might not have been initialized by then
+static void build_primitive_binary_ops() {
+    AST_Type *table_types[BINARY_OP_TABLE_TYPES] = {
+        &t_u8, &t_u16, &t_u32, &t_u64,
+        &t_i8, &t_i16, &t_i32, &t_i64,
+        &t_number_literal,
+    };
+    TokenType ops[BINARY_OP_TABLE_OPS] = { (TokenType)'+', (TokenType)'-', (TokenType)'*', (TokenType)'/', (TokenType)'%' };
+
+    for (TokenType op : ops) {
+        int op_index = binary_op_table_op_index(op);
+        for (AST_Type *lhs : table_types) {
+            for (AST_Type *rhs : table_types) {
+                int lhs_index = binary_op_table_type_index(lhs);
+                int rhs_index = binary_op_table_type_index(rhs);
+                assert(op_index >= 0 && lhs_index >= 0 && rhs_index >= 0);
+
+                primitive_binary_ops[op_index][lhs_index][rhs_index] = resolve_primitive_binary_op(op, lhs, rhs);
+            }
+        }
+    }
+}
+
+BinaryOpResolution *find_primitive_binary_op(TokenType op, AST_Type *lhs, AST_Type *rhs) {
+    static bool built = false;
+    if (!built) {
+        build_primitive_binary_ops();
+        built = true;
+    }
+
+    int op_index  = binary_op_table_op_index(op);
+    int lhs_index = binary_op_table_type_index(lhs);
+    int rhs_index = binary_op_table_type_index(rhs);
+
+    if (op_index < 0 || lhs_index < 0 || rhs_index < 0)
+        return nullptr;
+
+    BinaryOpResolution *res = &primitive_binary_ops[op_index][lhs_index][rhs_index];
+    return res->builder ? res : nullptr;
+}
+
+// This does what OpResolveJob does when there's no builder for the exact operand types:
+// pick the builder for which one of the operands has to be cast with the highest priority
+BinaryOpResolution resolve_primitive_binary_op(TokenType op, AST_Type *lhs, AST_Type *rhs) {
+    BinaryOpResolution res = {};
+
+    if (binary_builders.find({ op, lhs, rhs }, &res.builder))
+        return res;
+
+    int prio = 0;
+    for (auto &b : binary_builders) {
+        if (b.key.op != op)
+            continue;
+
+        BuiltinCast cast;
+        if (b.key.lhs == lhs && builtin_casts.find({ rhs, b.key.rhs }, &cast) && cast.priority > prio) {
+            res = { b.value, cast.fn, true };
+            prio = cast.priority;
+        }
+        else if (b.key.rhs == rhs && builtin_casts.find({ lhs, b.key.lhs }, &cast) && cast.priority > prio) {
+            res = { b.value, cast.fn, false };
+            prio = cast.priority;
+        }
+    }
+    return res;
+}
+
+
 struct TIR_CommonBinOpBuilder : TIR_Builder {
     TIR_OpCode opcode;
 
@@ -43,7 +155,7 @@ struct TIR_AssignmentBuilder : TIR_Builder {
 
     TIR_AssignmentBuilder() : TIR_Builder(true) {};
 
-    TIR_Value emit2(TIR_Function &fn, arr<AST_Value*> &args, TIR_Value dst) override {
+    TIR_Value emit2(TIR_Function &fn, arr_ref<AST_Value*> &args, TIR_Value dst) override {
         TIR_Value ptrloc;
 
         AST_Value *lhs = args[0];
@@ -92,9 +204,9 @@ inline bool number_literal_to_unsigned(AST_GlobalContext &global, AST_Value *src
         return false;
     }
 
-    // TODO LOCATION
     AST_SmallNumber *sn = global.alloc<AST_SmallNumber>(t);
     sn->u64_val = num;
+    sn->location_id = src->location_id;
     *dst = sn;
     return true;
 }
@@ -169,6 +281,5 @@ struct Initializer {
                 binary_builders[{p.op, t, t}] = builder;
             }
         }
-
     }
 } _;
@@ -32,4 +32,18 @@ u32 map_hash(BinaryOpKey key);
 bool map_equals(BinaryOpKey a, BinaryOpKey b);
 extern map <BinaryOpKey, struct TIR_Builder*> binary_builders;
 
+// Operators on two primitive operands are resolved ahead of time, including
+// the implicit casts needed to widen one operand to the other's type.
+// The table is filled in from binary_builders and builtin_casts on the first lookup.
+struct BinaryOpResolution {
+    struct TIR_Builder *builder;
+
+    // applied to the lhs or rhs before it's passed to the builder, nullptr if not needed
+    BuiltinCastFn cast;
+    bool cast_rhs;
+};
+
+// Returns nullptr if either operand isn't a primitive type or the operator isn't builtin
+BinaryOpResolution *find_primitive_binary_op(TokenType op, AST_Type *lhs, AST_Type *rhs);
+
 #endif // guard
@@ -0,0 +1,147 @@
+#include "tir_profile.h"
+#include "util.h"
+#include <algorithm>
+
+TIR_ProfileNode *TIR_ProfileNode::child(TIR_Function *fn) {
+    if (fn == this->fn)
+        return this;
+
+    for (TIR_ProfileNode *c : children)
+        if (c->fn == fn)
+            return c;
+
+    TIR_ProfileNode *c = new TIR_ProfileNode();
+    c->fn = fn;
+    children.push(c);
+    return c;
+}
+
+void TIR_Profile::sample(TIR_ExecutionJob *job) {
+    countdown = SAMPLE_INTERVAL;
+    samples++;
+
+    if (!job->profile_root) {
+        job->profile_root = new TIR_ProfileNode();
+        job->profile_root->fn = nullptr;
+        job->profile_root->name = wstring_to_utf8(job->get_name());
+        roots.push(job->profile_root);
+    }
+
+    // The frames under one that's already in the tree are the same as when it was added,
+    // so only the frames pushed since the last sample have to be looked up
+    arr<TIR_ExecutionJob::StackFrame> &frames = job->stackframes;
+    i64 i = (i64)frames.size - 1;
+    while (i >= 0 && !frames[i].profile_node)
+        i--;
+
+    TIR_ProfileNode *node = i >= 0 ? frames[i].profile_node : job->profile_root;
+    for (i++; i < (i64)frames.size; i++) {
+        node = node->child(frames[i].fn);
+        frames[i].profile_node = node;
+    }
+    node->self_samples++;
+}
+
+
+struct FnSamples {
+    TIR_Function *fn;
+    u64 inclusive, exclusive;
+
+    // How many times the function is on the path to the node that's being visited,
+    // a function only counts once per sample however many times it's on the stack
+    u32 on_path;
+};
+
+// Returns the samples in node and everything under it
+static u64 collect(TIR_ProfileNode *node, map<TIR_Function*, FnSamples> &fns) {
+    u64 total = node->self_samples;
+    FnSamples *fs = nullptr;
+
+    if (node->fn) {
+        fs = &fns[node->fn];
+        fs->fn = node->fn;
+        fs->exclusive += node->self_samples;
+        fs->on_path++;
+    }
+
+    for (TIR_ProfileNode *c : node->children)
+        total += collect(c, fns);
+
+    if (fs) {
+        // fns may have been grown by the children, so it's looked up again
+        fs = &fns[node->fn];
+        if (--fs->on_path == 0)
+            fs->inclusive += total;
+    }
+    return total;
+}
+
+void TIR_Profile::print_report(u64 exec_ns) {
+    fprintf(stderr, "--------- CTE profile ---------\n");
+    if (samples == 0) {
+        fprintf(stderr, "no samples, the interpreter ran less than %llu instructions\n", (unsigned long long)SAMPLE_INTERVAL);
+        return;
+    }
+
+    double ms_per_sample = exec_ns / 1e6 / samples;
+    fprintf(stderr, "%llu samples, one every %llu instructions, %.3f ms in the interpreter\n",
+            (unsigned long long)samples, (unsigned long long)SAMPLE_INTERVAL, exec_ns / 1e6);
+
+    map<TIR_Function*, FnSamples> fns;
+
+    fprintf(stderr, "\n%-40s %10s %12s %7s\n", "job", "samples", "ms", "%");
+    for (TIR_ProfileNode *root : roots) {
+        u64 total = collect(root, fns);
+        fprintf(stderr, "%-40s %10llu %12.3f %7.2f\n", root->name.c_str(), (unsigned long long)total,
+                total * ms_per_sample, 100.0 * total / samples);
+    }
+
+    arr<FnSamples> sorted;
+    for (auto &kvp : fns)
+        sorted.push(kvp.value);
+    std::sort(sorted.begin(), sorted.end(), [](const FnSamples &a, const FnSamples &b) {
+        return a.exclusive != b.exclusive ? a.exclusive > b.exclusive : a.inclusive > b.inclusive;
+    });
+
+    fprintf(stderr, "\n%-24s %14s %14s %7s %7s\n", "function", "inclusive ms", "exclusive ms", "incl %", "excl %");
+    for (FnSamples &fs : sorted) {
+        char name[64];
+        tir_fn_name(fs.fn, name, sizeof(name));
+        fprintf(stderr, "%-24s %14.3f %14.3f %7.2f %7.2f\n", name,
+                fs.inclusive * ms_per_sample, fs.exclusive * ms_per_sample,
+                100.0 * fs.inclusive / samples, 100.0 * fs.exclusive / samples);
+    }
+}
+
+static void write_folded_node(FILE *f, TIR_ProfileNode *node, std::string &stack) {
+    size_t len = stack.size();
+
+    if (node->fn) {
+        char name[64];
+        tir_fn_name(node->fn, name, sizeof(name));
+        stack += ";";
+        stack += name;
+    } else {
+        stack += node->name;
+    }
+
+    if (node->self_samples)
+        fprintf(f, "%s %llu\n", stack.c_str(), (unsigned long long)node->self_samples);
+    for (TIR_ProfileNode *c : node->children)
+        write_folded_node(f, c, stack);
+
+    stack.resize(len);
+}
+
+bool TIR_Profile::write_folded(const char *path) {
+    FILE *f = fopen(path, "wb");
+    if (!f)
+        return false;
+
+    std::string stack;
+    for (TIR_ProfileNode *root : roots)
+        write_folded_node(f, root, stack);
+
+    fclose(f);
+    return true;
+}
@@ -0,0 +1,43 @@
+#ifndef TIR_PROFILE_H
+#define TIR_PROFILE_H
+
+#include "tir.h"
+#include <string>
+
+// A node for every distinct stack the profile has seen.
+// The roots are the execution jobs, their children are the functions called from there.
+// A function calling itself directly stays on the same node, otherwise a recursion
+// would make the tree as deep as the recursion itself
+struct TIR_ProfileNode {
+    TIR_Function *fn;
+    std::string   name; // only for the roots, the job's name
+
+    // Samples taken while this was the innermost function
+    u64 self_samples = 0;
+    arr<TIR_ProfileNode*> children;
+
+    TIR_ProfileNode *child(TIR_Function *fn);
+};
+
+// With --profile-cte the interpreter records which functions are on the stack
+// every SAMPLE_INTERVAL instructions. The time estimates assume every instruction takes
+// as long, so they're the share of samples times the time spent in the interpreter
+struct TIR_Profile {
+    // Prime, so a loop body of a round number of instructions isn't always sampled at the same spot
+    static const u64 SAMPLE_INTERVAL = 1009;
+
+    u64 countdown = SAMPLE_INTERVAL;
+    u64 samples = 0;
+    arr<TIR_ProfileNode*> roots;
+
+    // Called by the interpreter when the countdown hits 0
+    void sample(TIR_ExecutionJob *job);
+
+    // Per job and per function inclusive and exclusive time, to stderr
+    void print_report(u64 exec_ns);
+
+    // One line per stack, "MainExecJob;main/0;fib/1 42", what flamegraph.pl and speedscope read
+    bool write_folded(const char *path);
+};
+
+#endif // guard
@@ -6,27 +6,33 @@
 
 #include <sstream>
 
-AST_PrimitiveType t_bool (PRIMITIVE_BOOL,     1, "bool");
-AST_PrimitiveType t_u8   (PRIMITIVE_UNSIGNED, 1, "u8");
-AST_PrimitiveType t_u16  (PRIMITIVE_UNSIGNED, 2, "u16");
-AST_PrimitiveType t_u32  (PRIMITIVE_UNSIGNED, 4, "u32");
-AST_PrimitiveType t_u64  (PRIMITIVE_UNSIGNED, 8, "u64");
-AST_PrimitiveType t_i8   (PRIMITIVE_SIGNED,   1, "i8");
-AST_PrimitiveType t_i16  (PRIMITIVE_SIGNED,   2, "i16");
-AST_PrimitiveType t_i32  (PRIMITIVE_SIGNED,   4, "i32");
-AST_PrimitiveType t_i64  (PRIMITIVE_SIGNED,   8, "i64");
-AST_PrimitiveType t_f32  (PRIMITIVE_FLOAT,    4, "f32");
-AST_PrimitiveType t_f64  (PRIMITIVE_FLOAT,    8, "f64");
-
-
-AST_PrimitiveType t_type           (PRIMITIVE_UNIQUE,  0, "type");
-AST_PrimitiveType t_void           (PRIMITIVE_UNIQUE,  0, "void");
-AST_PrimitiveType t_string_literal (PRIMITIVE_UNIQUE,  0, "string_literal");
-AST_PrimitiveType t_number_literal (PRIMITIVE_UNIQUE,  0, "number_literal");
+AST_PrimitiveType t_bool (1,  PRIMITIVE_BOOL,     1, "bool");
+AST_PrimitiveType t_u8   (2,  PRIMITIVE_UNSIGNED, 1, "u8");
+AST_PrimitiveType t_u16  (3,  PRIMITIVE_UNSIGNED, 2, "u16");
+AST_PrimitiveType t_u32  (4,  PRIMITIVE_UNSIGNED, 4, "u32");
+AST_PrimitiveType t_u64  (5,  PRIMITIVE_UNSIGNED, 8, "u64");
+AST_PrimitiveType t_i8   (6,  PRIMITIVE_SIGNED,   1, "i8");
+AST_PrimitiveType t_i16  (7,  PRIMITIVE_SIGNED,   2, "i16");
+AST_PrimitiveType t_i32  (8,  PRIMITIVE_SIGNED,   4, "i32");
+AST_PrimitiveType t_i64  (9,  PRIMITIVE_SIGNED,   8, "i64");
+AST_PrimitiveType t_f32  (10, PRIMITIVE_FLOAT,    4, "f32");
+AST_PrimitiveType t_f64  (11, PRIMITIVE_FLOAT,    8, "f64");
+
+
+AST_PrimitiveType t_type           (12, PRIMITIVE_UNIQUE,  0, "type");
+AST_PrimitiveType t_void           (13, PRIMITIVE_UNIQUE,  0, "void");
+AST_PrimitiveType t_string_literal (14, PRIMITIVE_UNIQUE,  0, "string_literal");
+AST_PrimitiveType t_number_literal (15, PRIMITIVE_UNIQUE,  0, "number_literal");
 
 // This is a special type that anything with size <= 8 can implicitly cast to
 // variadic arguments are assumed to be of type any8
-AST_PrimitiveType t_any8 (PRIMITIVE_UNIQUE, 8, "any8");
+AST_PrimitiveType t_any8 (16, PRIMITIVE_UNIQUE, 8, "any8");
+
+// In the order of their IDs, every TypeTable starts with these
+AST_PrimitiveType *primitive_types[PRIMITIVE_TYPES_COUNT] = {
+    &t_bool, &t_u8, &t_u16, &t_u32, &t_u64, &t_i8, &t_i16, &t_i32, &t_i64, &t_f32, &t_f64,
+    &t_type, &t_void, &t_string_literal, &t_number_literal, &t_any8,
+};
 
 arr<AST_Type*> unsigned_types = { &t_u64, &t_u32, &t_u16, &t_u8 };
 arr<AST_Type*>   signed_types = { &t_i64, &t_i32, &t_i16, &t_i8 };
@@ -38,6 +44,9 @@ struct GetTypeJob : Job {
 
     AST_Type *cache1, *cache2;
 
+    // The number of arguments that have already been typed, see WAIT_AND_RESUME
+    u32 index = 0;
+
     GetTypeJob(AST_Context &ctx, AST_Value *node) 
         : ctx(ctx), node(node), Job(ctx.global) { }
 
@@ -146,17 +155,17 @@ bool GetTypeJob::run(Message *msg) {
         case AST_FN_CALL: {
             AST_Call *fncall = (AST_Call*)node;
 
-            for (int i = 0; i < fncall->args.size; i++) {
+            for (; index < fncall->args.size; index++) {
                 // TODO TODO
-                GetTypeJob arg_gettype(ctx, fncall->args[i]);
-                WAIT (arg_gettype, GetTypeJob, GetTypeJob);
+                GetTypeJob arg_gettype(ctx, fncall->args[index]);
+                WAIT_AND_RESUME (arg_gettype, index, GetTypeJob, GetTypeJob);
             }
 
             if (fncall->op) {
                 OpResolveJob resolve_fn_job(ctx.global, fncall);
                 resolve_fn_job.fncall = fncall;
                 
-                WAIT (resolve_fn_job, GetTypeJob, CallResolveJob,
+                WAIT (resolve_fn_job, GetTypeJob, OpResolveJob,
                     ctx.subscribers.push(heap_job);
                 );
             } else {
@@ -300,25 +309,29 @@ bool TypeCheckJob::run(Message *msg) {
         case AST_BLOCK: {
             AST_Context* block = (AST_Context*)node;
 
-            for (const auto& decl : block->declarations) {
-                if (decl.value IS AST_VAR) {
-                    AST_Var* var = (AST_Var*)decl.value;
-
-                    TypeCheckJob var_typecheck(*block, var); 
-                    WAIT (var_typecheck, TypeCheckJob, TypeCheckJob);
-
-                    // TODO STRUCT
-                    // Right now structures are always on the stack
-                    // since they are always passed by pointer in LLVM
-                    // with the byval tag
-                    if (var->type IS AST_STRUCT)
-                        var->always_on_stack = true;
+            // stage 0 - the variables, stage 1 - the statements, index is the next statement
+            if (stage == 0) {
+                for (const auto& decl : block->declarations) {
+                    if (decl.value IS AST_VAR) {
+                        AST_Var* var = (AST_Var*)decl.value;
+
+                        TypeCheckJob var_typecheck(*block, var); 
+                        WAIT (var_typecheck, TypeCheckJob, TypeCheckJob);
+
+                        // TODO STRUCT
+                        // Right now structures are always on the stack
+                        // since they are always passed by pointer in LLVM
+                        // with the byval tag
+                        if (var->type IS AST_STRUCT)
+                            var->always_on_stack = true;
+                    }
                 }
+                stage = 1;
             }
 
-            for (const auto& stmt : block->statements) {
-                TypeCheckJob stmt_typecheck(*block, stmt); 
-                WAIT (stmt_typecheck, TypeCheckJob, TypeCheckJob);
+            for (; index < block->statements.size; index++) {
+                TypeCheckJob stmt_typecheck(*block, block->statements[index]); 
+                WAIT_AND_RESUME (stmt_typecheck, index, TypeCheckJob, TypeCheckJob);
             }
             return true;
         }
@@ -344,8 +357,24 @@ bool TypeCheckJob::run(Message *msg) {
                 ctx.decrement_hanging_declarations();
             }
 
-            TypeCheckJob fn_typecheck(fn->block, &fn->block); 
-            WAIT (fn_typecheck, TypeCheckJob, TypeCheckJob);
+            if (signature_only)
+                return true;
+
+            u32 errors_before = global.errors.size;
+            if (!parse_fn_body(fn)) {
+                if (!batch_errors) {
+                    for (u32 i = errors_before; i < global.errors.size; i++)
+                        print_err(global, global.errors[i]);
+                }
+                set_error_flag();
+                return false;
+            }
+
+            // The body's job keeps its own progress, once it's done there's nothing left to do
+            if (stage == 0) {
+                TypeCheckJob fn_typecheck(fn->block, &fn->block); 
+                WAIT_AND_RESUME (fn_typecheck, stage, TypeCheckJob, TypeCheckJob);
+            }
 
             return true;
         }
@@ -376,9 +405,10 @@ bool TypeCheckJob::run(Message *msg) {
             if (!rettype)
                 rettype = &t_void;
 
-            if (ret->value) {
+            // The cast's result is only in the CastJob, so that one is run again when we're woken up
+            if (ret->value && stage == 0) {
                 TypeCheckJob ret_typecheck(ctx, ret->value); 
-                WAIT (ret_typecheck, TypeCheckJob, TypeCheckJob);
+                WAIT_AND_RESUME (ret_typecheck, stage, TypeCheckJob, TypeCheckJob);
             }
 
             if (rettype != &t_void) {
@@ -406,11 +436,16 @@ bool TypeCheckJob::run(Message *msg) {
         case AST_IF: {
             AST_If* ifs = (AST_If*)node;
 
-            TypeCheckJob cond_typecheck(ctx, ifs->condition); 
-            WAIT (cond_typecheck, TypeCheckJob, TypeCheckJob);
+            if (stage == 0) {
+                TypeCheckJob cond_typecheck(ctx, ifs->condition); 
+                WAIT_AND_RESUME (cond_typecheck, stage, TypeCheckJob, TypeCheckJob);
+                stage = 1;
+            }
 
-            TypeCheckJob then_typecheck(ctx, &ifs->then_block); 
-            WAIT (then_typecheck, TypeCheckJob, TypeCheckJob);
+            if (stage == 1) {
+                TypeCheckJob then_typecheck(ctx, &ifs->then_block); 
+                WAIT_AND_RESUME (then_typecheck, stage, TypeCheckJob, TypeCheckJob);
+            }
 
             return true;
         }
@@ -418,11 +453,16 @@ bool TypeCheckJob::run(Message *msg) {
         case AST_WHILE: {
             AST_While* whiles = (AST_While*)node;
 
-            TypeCheckJob cond_typecheck(ctx, whiles->condition); 
-            WAIT (cond_typecheck, TypeCheckJob, TypeCheckJob);
+            if (stage == 0) {
+                TypeCheckJob cond_typecheck(ctx, whiles->condition); 
+                WAIT_AND_RESUME (cond_typecheck, stage, TypeCheckJob, TypeCheckJob);
+                stage = 1;
+            }
 
-            TypeCheckJob block_typecheck(ctx, &whiles->block); 
-            WAIT (block_typecheck, TypeCheckJob, TypeCheckJob);
+            if (stage == 1) {
+                TypeCheckJob block_typecheck(ctx, &whiles->block); 
+                WAIT_AND_RESUME (block_typecheck, stage, TypeCheckJob, TypeCheckJob);
+            }
 
             return true;
         }
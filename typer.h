@@ -21,6 +21,9 @@ extern AST_PrimitiveType t_string_literal;
 extern AST_PrimitiveType t_number_literal;
 extern AST_PrimitiveType t_any8;
 
+#define PRIMITIVE_TYPES_COUNT 16
+extern AST_PrimitiveType *primitive_types[PRIMITIVE_TYPES_COUNT];
+
 extern arr<AST_Type*> unsigned_types;
 extern arr<AST_Type*>   signed_types;
 
@@ -32,6 +35,14 @@ struct TypeCheckJob : Job {
 
     bool declared = false;
 
+    // With --demand-driven a function's job stops once the function is declared,
+    // its body is parsed and typechecked by another job when it's demanded (see TIR_Context::demand_fn)
+    bool signature_only = false;
+
+    // How far the job got before it last had to wait, see WAIT_AND_RESUME
+    u32 stage = 0;
+    u32 index = 0;
+
     TypeCheckJob(AST_Context& ctx, AST_Node* node);
 
     std::wstring get_name() override;
@@ -34,6 +34,40 @@ std::wostream& operator<<(std::wostream&, Red& r);
 std::wostream& operator<<(std::wostream&, ResetStyle& r);
 std::wostream& operator<<(std::wostream&, Dim& r);
 
+// A wide stream that does its own UTF-8 encoding and writes to stdout in large chunks.
+// Going through wcout converts every character with the locale and is very slow
+// for the -a/-t dumps and the job tracer. 
+// wout isn't ordered with wcout - flush it before printing anything to wcout.
+// The -j job trace flushes every line, it's most useful when an assert aborts before wout is flushed
+struct Utf8OutBuf : std::wstreambuf {
+    // Everything buffered up to this many bytes is written out with a single write
+    static const u64 WRITE_THRESHOLD = 1 << 20;
+
+    wchar_t area[4096];
+    std::string bytes;
+
+    // wchar_t is 16 bits on Windows, characters outside the BMP come as a pair of surrogates.
+    // A high surrogate at the end of the area waits here for its low half
+    u32 pending_high = 0;
+
+    Utf8OutBuf();
+    ~Utf8OutBuf();
+
+protected:
+    int_type overflow(int_type c) override;
+    int sync() override;
+
+private:
+    void encode(u32 code_point);
+    void encode_area();
+    void write_bytes();
+};
+
+extern std::wostream wout;
+
+// Writes directly to the stdout file descriptor, after flushing anything that's in stdio's buffer
+void write_stdout(const char *data, u64 size);
+
 void init_utils();
 int exec(std::wstring& programname, arr<std::wstring>& args);
 
@@ -34,3 +34,87 @@ std::string wstring_to_utf8 (const std::wstring& str) {
     std::wstring_convert<std::codecvt_utf8<wchar_t>> myconv;
     return myconv.to_bytes(str);
 }
+
+Utf8OutBuf::Utf8OutBuf() {
+    setp(area, area + sizeof(area) / sizeof(area[0]));
+}
+
+Utf8OutBuf::~Utf8OutBuf() {
+    sync();
+
+    // The low half is never coming
+    if (pending_high) {
+        encode(0xFFFD);
+        write_bytes();
+    }
+}
+
+void Utf8OutBuf::encode(u32 c) {
+    if (c < 0x80) {
+        bytes += (char)c;
+    } else if (c < 0x800) {
+        bytes += (char)(0xC0 | (c >> 6));
+        bytes += (char)(0x80 | (c & 0x3F));
+    } else if (c < 0x10000) {
+        bytes += (char)(0xE0 | (c >> 12));
+        bytes += (char)(0x80 | ((c >> 6) & 0x3F));
+        bytes += (char)(0x80 | (c & 0x3F));
+    } else {
+        bytes += (char)(0xF0 | (c >> 18));
+        bytes += (char)(0x80 | ((c >> 12) & 0x3F));
+        bytes += (char)(0x80 | ((c >> 6) & 0x3F));
+        bytes += (char)(0x80 | (c & 0x3F));
+    }
+}
+
+void Utf8OutBuf::encode_area() {
+    for (wchar_t *p = pbase(); p < pptr(); p++) {
+        u32 c = (u32)*p;
+
+        if (c >= 0xD800 && c < 0xDC00) {
+            if (pending_high)
+                encode(0xFFFD);
+            pending_high = c;
+            continue;
+        }
+
+        if (c >= 0xDC00 && c < 0xE000) {
+            // A low surrogate without a high one before it is replaced like any other invalid character
+            c = pending_high ? 0x10000 + ((pending_high - 0xD800) << 10) + (c - 0xDC00) : 0xFFFD;
+            pending_high = 0;
+        } else if (pending_high) {
+            encode(0xFFFD);
+            pending_high = 0;
+        }
+        encode(c);
+    }
+    setp(area, area + sizeof(area) / sizeof(area[0]));
+}
+
+void Utf8OutBuf::write_bytes() {
+    if (bytes.size()) {
+        write_stdout(bytes.data(), bytes.size());
+        bytes.clear();
+    }
+}
+
+Utf8OutBuf::int_type Utf8OutBuf::overflow(int_type c) {
+    encode_area();
+    if (bytes.size() >= WRITE_THRESHOLD)
+        write_bytes();
+
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+int Utf8OutBuf::sync() {
+    encode_area();
+    write_bytes();
+    return 0;
+}
+
+static Utf8OutBuf wout_buf;
+std::wostream wout(&wout_buf);
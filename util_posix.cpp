@@ -6,6 +6,7 @@
 #include <unistd.h>
 #include <dirent.h>
 #include <sstream>
+#include <errno.h>
 
 Red red;
 Dim dim;
@@ -13,6 +14,20 @@ ResetStyle resetstyle;
 
 const char PATH_SEPARATOR = ':';
 
+void write_stdout(const char *data, u64 size) {
+    fflush(stdout);
+    while (size > 0) {
+        ssize_t written = write(STDOUT_FILENO, data, size);
+        if (written < 0) {
+            if (errno == EINTR) 
+                continue;
+            return;
+        }
+        data += written;
+        size -= written;
+    }
+}
+
 void init_utils() {
     arr<std::wstring> path = read_path();
     for (std::wstring& entry : path) {
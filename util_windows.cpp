@@ -4,6 +4,7 @@
 #include <Windows.h>
 
 #include <comdef.h>
+#include <io.h>
 #include <sstream>
 #include <algorithm>
 
@@ -19,6 +20,18 @@ Red red;
 Dim dim;
 ResetStyle resetstyle;
 
+void write_stdout(const char *data, u64 size) {
+    fflush(stdout);
+    while (size > 0) {
+        int chunk = size > INT_MAX ? INT_MAX : (int)size;
+        int written = _write(1, data, chunk);
+        if (written < 0)
+            return;
+        data += written;
+        size -= written;
+    }
+}
+
 #include <Setup.Configuration.h>
 _COM_SMARTPTR_TYPEDEF(ISetupConfiguration, __uuidof(ISetupConfiguration));
 _COM_SMARTPTR_TYPEDEF(IEnumSetupInstances, __uuidof(IEnumSetupInstances));